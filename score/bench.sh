@@ -0,0 +1,27 @@
+#!/bin/bash
+
+echo "This is a simple benchmark shell script, run it after building ../code"
+echo "--------------------------------------------------------------------------------"
+
+# allocations per evaluated form (see --stats), over the whole test corpus
+echo ""
+echo "---------------------------"
+echo "Allocations: score/data"
+cat ./data/*.in > corpus.scm
+echo "(exit)" >> corpus.scm
+../code --stats < corpus.scm > /dev/null
+rm corpus.scm
+echo "---------------------------"
+
+# time and allocations of every program in bench/, on the tree-walker with
+# and without constant folding, and on the bytecode VM
+for f in ./bench/*.scm; do
+  for mode in "" "-O0" "--vm"; do
+    echo ""
+    echo "---------------------------"
+    echo "Ready to bench:" $f $mode
+    TIMEFORMAT="time: %3R s"
+    time ( (cat $f; echo "(exit)") | ../code --stats $mode > /dev/null )
+    echo "---------------------------"
+  done
+done
@@ -0,0 +1,3 @@
+(letrec ((fact (lambda (n) (if (= n 0) 1 (* n (fact (- n 1))))))
+         (loop (lambda (i) (if (= i 0) (fact 1000) (begin (fact 1000) (loop (- i 1)))))))
+  (< (* (fact 3000) (fact 3000)) (loop 20)))
@@ -0,0 +1,6 @@
+(letrec ((fold (lambda (f acc i)
+                 (if (= i 0)
+                     acc
+                     (fold f (f acc i) (- i 1))))))
+  (+ (fold + 0 300000)
+     (fold (lambda (acc i) (- acc 1)) 0 300000)))
@@ -0,0 +1,6 @@
+(letrec ((add4 (lambda (a) (lambda (b) (lambda (c) (lambda (d) (+ a b c d))))))
+         (loop (lambda (i acc)
+                 (if (= i 0)
+                     acc
+                     (loop (- i 1) ((((add4 i) 1) 2) acc))))))
+  (loop 500000 0))
@@ -0,0 +1,2 @@
+(letrec ((fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))))
+  (fib 25))
@@ -0,0 +1,22 @@
+(letrec ((loop (lambda (i acc)
+                 (if (= i 0)
+                     acc
+                     (loop (- i 1)
+                           (+ acc
+                              (+ (let ((n 5))
+                                   (let ((a 1))
+                                     (let ((a (* a n)))
+                                       (let ((n (- n 1)))
+                                         (let ((a (* a n)))
+                                           (let ((n (- n 1)))
+                                             (let ((a (* a n)))
+                                               (let ((n (- n 1)))
+                                                 (let ((a (* a n)))
+                                                   a)))))))))
+                                 (+ (if (= (+ 7 (* 2 4)) (- 20 (+ (+ 1 1) (+ (+ 1 1) 1))))
+                                        (+ 1 (+ 1 (+ 1 (+ 1 (+ 1 10)))))
+                                        0)
+                                    (+ (let ((x 7) (y 2))
+                                         (if (if (= x 7) (< y 0) (<= 0 y)) 77 88))
+                                       (car (cdr (quote (1 2 3)))))))))))))
+  (loop 200000 0))
@@ -0,0 +1,9 @@
+(letrec ((loop (lambda (i acc)
+                 (if (= i 0)
+                     acc
+                     (loop (- i 1)
+                           (letrec ((even? (lambda (n) (if (= n 0) #t (odd? (- n 1)))))
+                                    (odd? (lambda (n) (if (= n 0) #f (even? (- n 1)))))
+                                    (k (+ i 1)))
+                             (if (even? 3) acc (+ acc k))))))))
+  (loop 300000 0))
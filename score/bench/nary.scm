@@ -0,0 +1,5 @@
+(letrec ((loop (lambda (i acc)
+                 (if (= i 0)
+                     acc
+                     (loop (- i 1) (+ acc (+ i i i i i i i i i i i i i i i i i i i i)))))))
+  (loop 200000 0))
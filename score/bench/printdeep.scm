@@ -0,0 +1 @@
+(letrec ((build (lambda (i acc) (if (= i 0) acc (build (- i 1) (cons acc i)))))) (build 1000000 0))
@@ -0,0 +1,11 @@
+(letrec ((build (lambda (n acc) (if (= n 0) acc (build (- n 1) (cons n acc)))))
+         (callbacks (lambda (i fs)
+                      (if (= i 0)
+                          fs
+                          (callbacks (- i 1)
+                                     (cons (let ((big (build 10000 (quote ()))))
+                                             (let ((head (car big)))
+                                               (lambda () head)))
+                                           fs)))))
+         (sum (lambda (fs acc) (if (null? fs) acc (sum (cdr fs) (+ acc ((car fs))))))))
+  (sum (callbacks 200 (quote ())) 0))
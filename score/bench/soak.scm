@@ -0,0 +1 @@
+(letrec ((loop (lambda (n) (if (= n 0) (quote done) (let ((f (letrec ((f (lambda (x) (f x)))) f))) (loop (- n 1))))))) (loop 300000))
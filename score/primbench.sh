@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# ns per call of each primitive, run it after building ../code; extra
+# arguments go to ../code (e.g. ./primbench.sh --vm)
+#
+# Each primitive runs K times per iteration of a counting loop of N
+# iterations, and the time of the same loop with bare variables in its place
+# is subtracted. Times are the best of three runs.
+
+N=1000000
+K=20
+
+loop() {
+  local body=
+  for k in $(seq $K); do
+    body="$body $1"
+  done
+  echo "(letrec ((p (cons 1 2)) (loop (lambda (i) (if (= i 0) 0 (begin$body (loop (- i 1))))))) (loop $N))"
+  echo "(exit)"
+}
+
+ns() {
+  local prim=$1 start end best=
+  shift
+  for run in 1 2 3; do
+    start=$(date +%s%N)
+    loop "$prim" | ../code "$@" > /dev/null
+    end=$(date +%s%N)
+    if [ -z "$best" ] || [ $((end - start)) -lt $best ]; then
+      best=$((end - start))
+    fi
+  done
+  echo $best
+}
+
+base=$(ns "i" "$@")
+for prim in "(+ i 1)" "(- i 1)" "(* i 2)" "(< i 1)" "(= i 1)" "(eq? i p)" \
+            "(cons i i)" "(car p)" "(cdr p)" "(not i)" "(boolean? i)" \
+            "(fixnum? i)" "(null? p)" "(pair? p)" "(procedure? loop)" \
+            "(symbol? i)"; do
+  t=$(ns "$prim" "$@")
+  printf "%-20s %6d ns/op\n" "$prim" $(((t - base) / (N * K)))
+done
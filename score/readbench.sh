@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# reader throughput in MB/s, run it after building ../code; extra arguments
+# go to ../code
+#
+# The input is about 100 MB of forms (lambda () (quote <datum>)): the datum
+# is read and parsed but never built, so the time is mostly the reader's.
+
+SIZE=$((100 * 1024 * 1024))
+file=$(mktemp)
+trap 'rm -f $file $file.block' EXIT
+
+datum="(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))"
+datum="$datum (let ((x 12345) (y -678) (z 2147483648)) [cons x (y z #t #f)])"
+datum="$datum (some-longer-identifier another-one a b c d 1 22 333 4444)"
+for i in $(seq 16); do
+  echo "(lambda () (quote ($datum $i)))"
+done > $file.block
+while [ $(stat -c %s $file.block) -lt $SIZE ]; do
+  cat $file.block $file.block > $file
+  mv $file $file.block
+done
+echo "(exit)" >> $file.block
+bytes=$(stat -c %s $file.block)
+
+best=
+for run in 1 2 3; do
+  start=$(date +%s%N)
+  ../code "$@" < $file.block > /dev/null
+  end=$(date +%s%N)
+  if [ -z "$best" ] || [ $((end - start)) -lt $best ]; then
+    best=$((end - start))
+  fi
+done
+echo "read $((bytes / 1000000)) MB in $((best / 1000000)) ms:" \
+  "$((bytes * 1000 / best)) MB/s"
@@ -3,6 +3,8 @@
 echo "This is a simple score shell script for you to find out problems in your program"
 echo "--------------------------------------------------------------------------------"
 
+# arguments are passed on to ../code, e.g. ./score.sh --vm
+
 L=1
 R=119
 for ((i = $L; i <= $R; i = i + 1))
@@ -10,7 +12,7 @@ do
     echo ""
     echo "---------------------------"
     echo "Ready to test: TEST" $i
-    ../code << EOF > scm.out
+    ../code "$@" << EOF > scm.out
     $(cat ./data/$i.in)
     (exit)
 EOF
@@ -30,13 +32,13 @@ EOF
 done
 
 L_EXTRA=1
-R_EXTRA=7
+R_EXTRA=23
 for ((i = $L_EXTRA; i <= $R_EXTRA; i = i + 1))
 do
     echo ""
     echo "---------------------------"
     echo "Ready to test: EXTRA TEST" $i
-    ../code << EOF > scm.out
+    ../code "$@" << EOF > scm.out
     $(cat ./more-tests/$i.in)
     (exit)
 EOF
@@ -1,39 +1,92 @@
 #include "Def.hpp"
+#include <cstring>
 
-std::map<std::string, ExprType> primitives;
-std::map<std::string, ExprType> reserved_words;
-
-void initPrimitives() {
-  // primitives stores all procedures in library, mapping them to ExprTypes
-  primitives["*"] = E_MUL;
-  primitives["-"] = E_MINUS;
-  primitives["+"] = E_PLUS;
-  primitives["<"] = E_LT;
-  primitives["<="] = E_LE;
-  primitives["="] = E_EQ;
-  primitives[">="] = E_GE;
-  primitives[">"] = E_GT;
-  primitives["void"] = E_VOID;
-  primitives["eq?"] = E_EQQ;
-  primitives["boolean?"] = E_BOOLQ;
-  primitives["fixnum?"] = E_INTQ;
-  primitives["null?"] = E_NULLQ;
-  primitives["pair?"] = E_PAIRQ;
-  primitives["procedure?"] = E_PROCQ;
-  primitives["symbol?"] = E_SYMBOLQ;
-  primitives["cons"] = E_CONS;
-  primitives["not"] = E_NOT;
-  primitives["car"] = E_CAR;
-  primitives["cdr"] = E_CDR;
-  primitives["exit"] = E_EXIT;
+bool lexical_addressing = true;
+bool fold_constants = true;
+
+namespace {
+
+struct Entry {
+  const char *name;
+  Keyword k;
+};
+
+// every procedure in library and every reserved word
+constexpr Entry entries[] = {
+    {"*", {E_MUL, K_PRIMITIVE}},         {"-", {E_MINUS, K_PRIMITIVE}},
+    {"+", {E_PLUS, K_PRIMITIVE}},        {"<", {E_LT, K_PRIMITIVE}},
+    {"<=", {E_LE, K_PRIMITIVE}},         {"=", {E_EQ, K_PRIMITIVE}},
+    {">=", {E_GE, K_PRIMITIVE}},         {">", {E_GT, K_PRIMITIVE}},
+    {"void", {E_VOID, K_PRIMITIVE}},     {"eq?", {E_EQQ, K_PRIMITIVE}},
+    {"boolean?", {E_BOOLQ, K_PRIMITIVE}}, {"fixnum?", {E_INTQ, K_PRIMITIVE}},
+    {"null?", {E_NULLQ, K_PRIMITIVE}},   {"pair?", {E_PAIRQ, K_PRIMITIVE}},
+    {"procedure?", {E_PROCQ, K_PRIMITIVE}},
+    {"symbol?", {E_SYMBOLQ, K_PRIMITIVE}}, {"cons", {E_CONS, K_PRIMITIVE}},
+    {"not", {E_NOT, K_PRIMITIVE}},       {"car", {E_CAR, K_PRIMITIVE}},
+    {"cdr", {E_CDR, K_PRIMITIVE}},       {"exit", {E_EXIT, K_PRIMITIVE}},
+    {"let", {E_LET, K_RESERVED}},        {"lambda", {E_LAMBDA, K_RESERVED}},
+    {"letrec", {E_LETREC, K_RESERVED}},  {"if", {E_IF, K_RESERVED}},
+    {"begin", {E_BEGIN, K_RESERVED}},    {"quote", {E_QUOTE, K_RESERVED}}};
+
+constexpr size_t SLOTS = 64; // a power of two, over twice the entries
+
+constexpr size_t length(const char *s) {
+  size_t n = 0;
+  while (s[n])
+    ++n;
+  return n;
+}
+
+// FNV-1a from the given seed, reduced to a slot
+constexpr size_t slot(const char *s, size_t n, unsigned seed) {
+  unsigned h = seed;
+  for (size_t i = 0; i < n; ++i)
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  return (h ^ (h >> 16)) & (SLOTS - 1);
+}
+
+constexpr bool perfect(unsigned seed) {
+  bool used[SLOTS] = {};
+  for (const Entry &e : entries) {
+    size_t i = slot(e.name, length(e.name), seed);
+    if (used[i])
+      return false;
+    used[i] = true;
+  }
+  return true;
 }
 
-void initReservedWords() {
-  // reserved_words stores all reserved words, mapping them to bools
-  reserved_words["let"] = E_LET;
-  reserved_words["lambda"] = E_LAMBDA;
-  reserved_words["letrec"] = E_LETREC;
-  reserved_words["if"] = E_IF;
-  reserved_words["begin"] = E_BEGIN;
-  reserved_words["quote"] = E_QUOTE;
+// the first seed sending every entry to a slot of its own
+constexpr unsigned findSeed() {
+  unsigned seed = 2166136261u;
+  while (!perfect(seed))
+    ++seed;
+  return seed;
+}
+
+constexpr unsigned SEED = findSeed();
+
+struct Table {
+  signed char entry[SLOTS]; // index into entries, -1 if empty
+};
+
+constexpr Table makeTable() {
+  Table t{};
+  for (size_t i = 0; i < SLOTS; ++i)
+    t.entry[i] = -1;
+  for (size_t i = 0; i < sizeof(entries) / sizeof(*entries); ++i)
+    t.entry[slot(entries[i].name, length(entries[i].name), SEED)] = i;
+  return t;
+}
+
+constexpr Table table = makeTable();
+
+} // namespace
+
+Keyword lookupKeyword(const char *s, size_t n) {
+  int i = table.entry[slot(s, n, SEED)];
+  if (i >= 0 && length(entries[i].name) == n &&
+      !memcmp(entries[i].name, s, n))
+    return entries[i].k;
+  return {E_VAR, K_NONE};
 }
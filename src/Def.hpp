@@ -14,6 +14,9 @@ struct Expr;
 struct Value;
 struct AssocList;
 struct Assoc;
+struct Tail;
+struct Symbol;
+struct Scope;
 
 enum ExprType {
   E_LET,
@@ -47,7 +50,9 @@ enum ExprType {
   E_PAIRQ,
   E_PROCQ,
   E_SYMBOLQ,
-  E_EXIT
+  E_EXIT,
+  E_CONST,
+  E_NARY
 };
 
 enum ValueType {
@@ -60,11 +65,23 @@ enum ValueType {
   V_PROC,
   V_VOID,
   V_PRIMITIVE,
-  V_EXPRESSION,
-  V_TERMINATE
+  V_TERMINATE,
+  V_BOX,
+  V_BIGNUM
 };
 
-void initPrimitives();
-void initReservedWords();
+enum KeywordKind { K_NONE, K_PRIMITIVE, K_RESERVED };
+
+struct Keyword {
+  /*
+      @attr type: the primitive or special form a keyword names
+  */
+  ExprType type;
+  KeywordKind kind;
+};
+
+// finds the primitive or reserved word spelled by s[0, n) in a table built at
+// compile time; kind is K_NONE for any other name
+Keyword lookupKeyword(const char *s, size_t n);
 
 #endif
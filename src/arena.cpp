@@ -0,0 +1,62 @@
+#include "arena.hpp"
+#include "stats.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// chunks are aligned to their size, so a node finds its chunk by masking
+static const size_t CHUNK_SIZE = 1 << 16;
+static const size_t ALIGN = alignof(std::max_align_t);
+
+struct Arena::Chunk {
+  size_t live;  // nodes allocated here and not yet deleted
+  bool retired; // the arena has moved on to another chunk
+};
+
+static const size_t HEADER = (sizeof(Arena::Chunk) + ALIGN - 1) & ~(ALIGN - 1);
+
+Arena syntax_arena;
+Arena expr_arena;
+
+Arena::Arena() : current(nullptr), next(nullptr), end(nullptr) {}
+
+void *Arena::allocate(size_t n) {
+  n = (n + ALIGN - 1) & ~(ALIGN - 1);
+  if (n > (size_t)(end - next)) {
+    if (current && current->live == 0)
+      next = (char *)current + HEADER;
+    else {
+      reset();
+      stats.allocations++;
+      current = (Chunk *)aligned_alloc(CHUNK_SIZE, CHUNK_SIZE);
+      if (!current)
+        throw std::bad_alloc();
+      current->live = 0;
+      current->retired = false;
+      next = (char *)current + HEADER;
+      end = (char *)current + CHUNK_SIZE;
+    }
+  }
+  current->live++;
+  void *p = next;
+  next += n;
+  return p;
+}
+
+void Arena::deallocate(void *p) {
+  Chunk *c = (Chunk *)((uintptr_t)p & ~(uintptr_t)(CHUNK_SIZE - 1));
+  if (--c->live == 0 && c->retired)
+    free(c);
+}
+
+void Arena::reset() {
+  if (!current)
+    return;
+  if (current->live == 0) {
+    next = (char *)current + HEADER;
+    return;
+  }
+  current->retired = true;
+  current = nullptr;
+  next = end = nullptr;
+}
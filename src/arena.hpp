@@ -0,0 +1,30 @@
+#ifndef ARENA
+#define ARENA
+
+#include <cstddef>
+
+// Bump allocator for AST nodes. Memory is taken in aligned chunks, each
+// counting the nodes still alive in it: a chunk goes back to malloc once the
+// arena has moved past it and its last node is deleted, so nodes keep their
+// refcounted lifetimes without a malloc of their own.
+class Arena {
+public:
+  Arena();
+  void *allocate(size_t);
+  static void deallocate(void *);
+  // let the next allocations start on fresh memory, reusing the current chunk
+  // if nothing in it is alive any more
+  void reset();
+
+  struct Chunk;
+
+private:
+  Chunk *current;
+  char *next;
+  char *end;
+};
+
+extern Arena syntax_arena; // reset for every top-level form
+extern Arena expr_arena;   // never reset: Expr nodes live as long as closures
+
+#endif
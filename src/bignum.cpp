@@ -0,0 +1,244 @@
+#include "Def.hpp"
+#include "RE.hpp"
+#include "value.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <vector>
+using std::vector;
+
+// Integers beyond the fixnum range. The primitives compute on two fixnums
+// inline and only come here once an operand is a bignum or the machine
+// operation overflowed (__builtin_*_overflow), so fixnum-only code never
+// touches this file. A bignum is a sign and a magnitude in base 2^32 limbs;
+// every result is normalized, so a fixnum-sized value is never a Bignum.
+
+typedef vector<uint32_t> Limbs;
+
+// below this many limbs in the shorter operand, schoolbook multiplication
+// beats Karatsuba's extra additions and allocations
+static const size_t KARATSUBA_THRESHOLD = 32;
+
+Bignum::Bignum(bool negative, Limbs &&limbs)
+    : ValueBase(V_BIGNUM), negative(negative), limbs(std::move(limbs)) {}
+
+static void trim(Limbs &a) {
+  while (!a.empty() && a.back() == 0)
+    a.pop_back();
+}
+
+static int compareMag(const Limbs &a, const Limbs &b) {
+  if (a.size() != b.size())
+    return a.size() < b.size() ? -1 : 1;
+  for (size_t i = a.size(); i-- > 0;)
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+  return 0;
+}
+
+// a += b * 2^(32 shift)
+static void addMag(Limbs &a, const Limbs &b, size_t shift = 0) {
+  if (b.empty())
+    return;
+  if (a.size() < b.size() + shift)
+    a.resize(b.size() + shift, 0);
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < b.size(); ++i) {
+    uint64_t t = (uint64_t)a[i + shift] + b[i] + carry;
+    a[i + shift] = (uint32_t)t;
+    carry = t >> 32;
+  }
+  for (i += shift; carry; ++i) {
+    if (i == a.size())
+      a.push_back(0);
+    uint64_t t = (uint64_t)a[i] + carry;
+    a[i] = (uint32_t)t;
+    carry = t >> 32;
+  }
+}
+
+// a -= b, where a >= b
+static void subMag(Limbs &a, const Limbs &b) {
+  int64_t borrow = 0;
+  for (size_t i = 0; i < a.size() && (i < b.size() || borrow); ++i) {
+    int64_t t = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+    borrow = t < 0;
+    a[i] = (uint32_t)t;
+  }
+  trim(a);
+}
+
+static Limbs mulSchoolbook(const Limbs &a, const Limbs &b) {
+  if (a.empty() || b.empty())
+    return Limbs();
+  Limbs r(a.size() + b.size(), 0);
+  for (size_t i = 0; i < a.size(); ++i) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < b.size(); ++j) {
+      uint64_t t = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+      r[i + j] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    r[i + b.size()] = (uint32_t)carry;
+  }
+  trim(r);
+  return r;
+}
+
+static Limbs slice(const Limbs &a, size_t from, size_t to) {
+  to = std::min(to, a.size());
+  Limbs r(a.begin() + std::min(from, to), a.begin() + to);
+  trim(r);
+  return r;
+}
+
+static Limbs mulMag(const Limbs &a, const Limbs &b) {
+  if (std::min(a.size(), b.size()) < KARATSUBA_THRESHOLD)
+    return mulSchoolbook(a, b);
+  size_t m = std::max(a.size(), b.size()) / 2;
+  Limbs a0 = slice(a, 0, m), a1 = slice(a, m, a.size());
+  if (b.size() <= m) {
+    // only a is worth splitting
+    Limbs r = mulMag(a0, b);
+    addMag(r, mulMag(a1, b), m);
+    return r;
+  }
+  if (a.size() <= m) {
+    Limbs b0 = slice(b, 0, m), b1 = slice(b, m, b.size());
+    Limbs r = mulMag(a, b0);
+    addMag(r, mulMag(a, b1), m);
+    return r;
+  }
+  // with a = a1 B + a0 and b = b1 B + b0 (B = 2^(32 m)), z0 = a0 b0 and
+  // z2 = a1 b1: a b = z2 B^2 + ((a0 + a1)(b0 + b1) - z0 - z2) B + z0
+  Limbs b0 = slice(b, 0, m), b1 = slice(b, m, b.size());
+  Limbs z0 = mulMag(a0, b0), z2 = mulMag(a1, b1);
+  addMag(a0, a1);
+  addMag(b0, b1);
+  Limbs z1 = mulMag(a0, b0);
+  subMag(z1, z0);
+  subMag(z1, z2);
+  Limbs r = std::move(z0);
+  addMag(r, z1, m);
+  addMag(r, z2, 2 * m);
+  trim(r);
+  return r;
+}
+
+namespace {
+struct Integer {
+  bool negative;
+  Limbs mag;
+};
+} // namespace
+
+static Integer integer(const Value &v) {
+  if (v.type() == V_INT) {
+    int n = v.fixnum();
+    Integer r{n < 0, Limbs()};
+    uint32_t m = n < 0 ? 0u - (uint32_t)n : (uint32_t)n;
+    if (m)
+      r.mag.push_back(m);
+    return r;
+  }
+  if (v.type() == V_BIGNUM) {
+    Bignum *b = static_cast<Bignum *>(v.get());
+    return Integer{b->negative, b->limbs};
+  }
+  throw RuntimeError("Type error on line " + std::to_string(__LINE__));
+}
+
+static Value normalize(Integer &&x) {
+  trim(x.mag);
+  if (x.mag.empty())
+    return IntegerV(0);
+  if (x.mag.size() == 1) {
+    uint32_t m = x.mag[0];
+    if (!x.negative && m <= (uint32_t)INT_MAX)
+      return IntegerV((int)m);
+    if (x.negative && m <= (uint32_t)INT_MAX + 1)
+      return IntegerV((int)-(int64_t)m);
+  }
+  return Value(new Bignum(x.negative, std::move(x.mag)));
+}
+
+static Value add(Integer &&a, Integer &&b) {
+  if (a.negative == b.negative) {
+    addMag(a.mag, b.mag);
+    return normalize(std::move(a));
+  }
+  if (compareMag(a.mag, b.mag) < 0)
+    std::swap(a, b);
+  subMag(a.mag, b.mag);
+  return normalize(std::move(a));
+}
+
+bool isInteger(const Value &v) {
+  return v.type() == V_INT || v.type() == V_BIGNUM;
+}
+
+Value numAdd(const Value &x, const Value &y) {
+  return add(integer(x), integer(y));
+}
+
+Value numSub(const Value &x, const Value &y) {
+  Integer b = integer(y);
+  b.negative = !b.negative;
+  return add(integer(x), std::move(b));
+}
+
+Value numMul(const Value &x, const Value &y) {
+  Integer a = integer(x), b = integer(y);
+  return normalize(Integer{a.negative != b.negative, mulMag(a.mag, b.mag)});
+}
+
+int numCompare(const Value &x, const Value &y) {
+  if (x.type() == V_INT && y.type() == V_INT)
+    return (x.fixnum() > y.fixnum()) - (x.fixnum() < y.fixnum());
+  Integer a = integer(x), b = integer(y);
+  // zero is a fixnum, so a negative sign is never on a zero here
+  if (a.negative != b.negative)
+    return a.negative ? -1 : 1;
+  int c = compareMag(a.mag, b.mag);
+  return a.negative ? -c : c;
+}
+
+Value parseInteger(const std::string &digits, bool negative) {
+  Integer r{negative, Limbs()};
+  for (char c : digits) {
+    uint64_t carry = c - '0';
+    for (uint32_t &limb : r.mag) {
+      uint64_t t = (uint64_t)limb * 10 + carry;
+      limb = (uint32_t)t;
+      carry = t >> 32;
+    }
+    if (carry)
+      r.mag.push_back((uint32_t)carry);
+  }
+  return normalize(std::move(r));
+}
+
+void Bignum::show(std::string &out) {
+  // peel off base 10^9 digits, least significant first
+  Limbs q = limbs;
+  vector<uint32_t> chunks;
+  while (!q.empty()) {
+    uint64_t rem = 0;
+    for (size_t i = q.size(); i-- > 0;) {
+      uint64_t t = (rem << 32) | q[i];
+      q[i] = (uint32_t)(t / 1000000000);
+      rem = t % 1000000000;
+    }
+    trim(q);
+    chunks.push_back((uint32_t)rem);
+  }
+  if (negative)
+    out += '-';
+  out += std::to_string(chunks.back());
+  char buf[16];
+  for (size_t i = chunks.size() - 1; i-- > 0;) {
+    snprintf(buf, sizeof buf, "%09u", chunks[i]);
+    out += buf;
+  }
+}
@@ -1,130 +1,292 @@
 #include "Def.hpp"
 #include "RE.hpp"
 #include "expr.hpp"
+#include "gc.hpp"
+#include "stats.hpp"
 #include "syntax.hpp"
 #include "value.hpp"
 #include <cstring>
 #include <map>
 #include <vector>
 
-extern std::map<std::string, ExprType> primitives;
-extern std::map<std::string, ExprType> reserved_words;
+extern bool lexical_addressing;
 
-Value Let::eval(Assoc &env) {
-  Assoc env1 = env;
-  for (auto &i : bind) {
-    env1 = extend(i.first, i.second.get()->eval(env), env1);
-  }
-  return body.get()->eval(env1);
+// Expressions with a subexpression in tail position (if, begin, let, letrec
+// and calls) evaluate through step(), which hands that subexpression back
+// instead of recursing into it, so iterative code runs in constant C++ stack.
+static Value run(ExprBase *e, Assoc &env) {
+  Tail t(env);
+  while ((e = e->step(t)))
+    maybeCollect();
+  return t.val;
+}
+
+ExprBase *ExprBase::step(Tail &t) {
+  t.val = eval(t.env);
+  return nullptr;
+}
+
+Value Let::eval(Assoc &env) { return run(this, env); }
+
+ExprBase *Let::step(Tail &t) {
+  Assoc env1 = pushFrame(bind.size(), t.env);
+  for (size_t i = 0; i < bind.size(); ++i)
+    ::bind(env1, i, bind[i].first, bind[i].second.get()->eval(t.env));
+  t.env = env1;
+  return body.get();
 } // let expression
 
 Value Lambda::eval(Assoc &env) {
-  return ClosureV(x, e, env);
+  // the closure's frame: a copy of each free variable (see resolve.cpp)
+  Assoc frame(nullptr);
+  if (!free.empty()) {
+    frame = extend(free.size(), frame);
+    for (size_t i = 0; i < free.size(); ++i) {
+      Var *v = static_cast<Var *>(free[i].get());
+      // the slot itself, so a letrec Box is shared rather than opened
+      ::bind(frame, i, v->x,
+             lexical_addressing ? find(v->depth, v->index, env)
+                                : find(v->x, env));
+    }
+  }
+  return ClosureV(this, frame);
 } // lambda expression
 
-Value Apply::eval(Assoc &env) {
-  Value rator = this->rator.get()->eval(env);
+Value Apply::eval(Assoc &env) { return run(this, env); }
+
+// arguments of tail calls, held while the caller's frames are popped
+static std::vector<Value> pending_args;
+
+// whether body only applies a primitive to the n parameters, in order
+static bool appliesPrimitive(ExprBase *body, size_t n) {
+  auto param = [](const Expr &e, int i) {
+    return e->e_type == E_VAR && static_cast<Var *>(e.get())->depth == 0 &&
+           static_cast<Var *>(e.get())->index == i;
+  };
+  switch (body->e_type) {
+  case E_MUL:
+  case E_PLUS:
+  case E_MINUS:
+  case E_LT:
+  case E_LE:
+  case E_EQ:
+  case E_GE:
+  case E_GT:
+  case E_EQQ:
+  case E_CONS: {
+    Binary *b = static_cast<Binary *>(body);
+    return n == 2 && param(b->rand1, 0) && param(b->rand2, 1);
+  }
+  case E_BOOLQ:
+  case E_INTQ:
+  case E_NULLQ:
+  case E_PAIRQ:
+  case E_PROCQ:
+  case E_SYMBOLQ:
+  case E_NOT:
+  case E_CAR:
+  case E_CDR:
+    return n == 1 && param(static_cast<Unary *>(body)->rand, 0);
+  default:
+    return false;
+  }
+}
+
+// counts for a call site, named after its operator
+static CallSite *newCallSite(ExprBase *rator) {
+  std::string name = rator->e_type == E_VAR
+                         ? static_cast<Var *>(rator)->x->s
+                         : rator->e_type == E_LAMBDA ? "lambda" : "expression";
+  stats.call_sites.push_back(CallSite{name, 0, 0});
+  return &stats.call_sites.back();
+}
 
-  auto closure = dynamic_cast<Closure *>(rator.get());
-  if (closure) {
-    if (closure->parameters.size() != this->rand.size()) {
+ExprBase *Apply::step(Tail &t) {
+  Value rator = this->rator.get()->eval(t.env);
+  if (rator.type() == V_PRIMITIVE) {
+    // called natively, with no frame
+    Primitive *p = static_cast<Primitive *>(rator.get());
+    if (p->arity < 0) {
+      std::vector<Value> args;
+      args.reserve(rand.size());
+      for (auto &i : rand)
+        args.push_back(i->eval(t.env));
+      t.val = applyPrimitive(p, args.data(), args.size());
+      return nullptr;
+    }
+    if (rand.size() != (size_t)p->arity)
+      throw RuntimeError("Expect " + std::to_string(p->arity) +
+                         " argument(s), found " +
+                         std::to_string(rand.size()));
+    Value args[2] = {Value(nullptr), Value(nullptr)};
+    for (size_t i = 0; i < rand.size(); ++i)
+      args[i] = rand[i]->eval(t.env);
+    t.val = applyPrimitive(p, args, rand.size());
+    return nullptr;
+  }
+  if (rator.type() != V_PROC)
+    throw RuntimeError("Bad function call");
+  // the only procedures the tree-walker makes are closures
+  Closure *closure = static_cast<Closure *>(rator.get());
+  Lambda *lambda = closure->lambda.get();
+  ExprBase *body = lambda->e.get();
+
+  if (lambda == callee && lambda->serial == callee_serial) {
+    ++stats.call_hits;
+    if (site)
+      ++site->hits;
+  } else {
+    ++stats.call_misses;
+    if (stats.per_site && !site)
+      site = newCallSite(this->rator.get());
+    if (site)
+      ++site->misses;
+    if (lambda->x.size() != this->rand.size()) {
       throw RuntimeError(
-          "Expect " + std::to_string(closure->parameters.size()) +
+          "Expect " + std::to_string(lambda->x.size()) +
           " argument(s), found " + std::to_string(this->rand.size()));
     }
+    callee = lambda;
+    callee_serial = lambda->serial;
+    direct = appliesPrimitive(body, rand.size());
+  }
 
-    Assoc env1 = Assoc(closure->env);
-    for (size_t i = 0; i < closure->parameters.size(); ++i) {
-      env1 =
-          extend(closure->parameters[i], this->rand[i].get()->eval(env), env1);
+  if (direct) {
+    Value x = rand[0]->eval(t.env);
+    if (rand.size() == 1)
+      t.val = static_cast<Unary *>(body)->evalRator(x);
+    else {
+      Value y = rand[1]->eval(t.env);
+      t.val = static_cast<Binary *>(body)->evalRator(x, y);
     }
-
-    return closure->e.get()->eval(env1);
+    return nullptr;
   }
 
-  throw RuntimeError("Bad function call");
-} // for function calling
-
-Value Letrec::eval(Assoc &env) {
-  Assoc env1 = env;
-  for (auto &i : this->bind) {
-    env1 = extend(i.first, NullV(), env1);
-  }
-
-  Assoc env2 = env;
-
-  for (auto &i : this->bind) {
-    Value val = i.second.get()->eval(env1);
-    if (val.get()->v_type == V_NULL)
-      throw RuntimeError("Unusable variable");
-    env2 = extend(i.first, val, env2);
+  size_t n = rand.size();
+  if (frameHeight() == t.frames) {
+    // nothing of this evaluation's to pop: the arguments go straight into
+    // the new frame
+    Assoc env1 = pushFrame(n, closure->env);
+    for (size_t i = 0; i < n; ++i)
+      bind(env1, i, lambda->x[i], this->rand[i].get()->eval(t.env));
+    t.env = env1;
+  } else {
+    // a tail call: the frames this evaluation pushed so far are dead once
+    // the arguments have been evaluated in them, so the callee's frame takes
+    // their place and a loop runs in constant space
+    struct Truncate {
+      size_t base;
+      ~Truncate() { pending_args.resize(base, Value(nullptr)); }
+    } args{pending_args.size()};
+    for (size_t i = 0; i < n; ++i)
+      pending_args.push_back(this->rand[i].get()->eval(t.env));
+    t.env = Assoc(nullptr);
+    popFrames(t.frames);
+    Assoc env1 = pushFrame(n, closure->env);
+    for (size_t i = 0; i < n; ++i)
+      bind(env1, i, lambda->x[i], pending_args[args.base + i]);
+    t.env = env1;
   }
+  t.proc = std::move(rator);
+  return body;
+} // for function calling
 
-  for (auto &i : this->bind) {
-    Value val = find(i.first, env2);    
-    modify(i.first, i.second.get()->eval(env2), env2);
+Value Letrec::eval(Assoc &env) { return run(this, env); }
+
+ExprBase *Letrec::step(Tail &t) {
+  // one frame of Boxes, which closures made by the bindings share; they stay
+  // empty until every binding has been evaluated in the frame: reading one
+  // before that is an "Unusable variable" (Var::eval)
+  size_t n = bind.size();
+  Assoc env1 = pushFrame(n, t.env);
+  for (size_t i = 0; i < n; ++i)
+    ::bind(env1, i, bind[i].first, Value(new Box(Value(nullptr))));
+
+  auto box = [&](size_t i) {
+    return static_cast<Box *>(env1->slots[i].get());
+  };
+  if (n == 1)
+    box(0)->v = bind[0].second.get()->eval(env1);
+  else {
+    std::vector<Value> vals;
+    vals.reserve(n);
+    for (auto &i : bind)
+      vals.push_back(i.second.get()->eval(env1));
+    for (size_t i = 0; i < n; ++i)
+      box(i)->v = std::move(vals[i]);
   }
 
-  return body.get()->eval(env2);
+  t.env = env1;
+  return body.get();
 } // letrec expression
 
 Value Var::eval(Assoc &e) {
-  Value res = find(x, e);
-  if (res.get())
+  Value res = lexical_addressing ? find(depth, index, e) : find(x, e);
+  if (boxed)
+    res = static_cast<Box *>(res.get())->v;
+  if (res)
     return res;
+  else if (boxed)
+    throw RuntimeError("Unusable variable"); // a letrec Box not yet set
   else
-    throw RuntimeError("Unbound variable: " + x);
+    throw RuntimeError("Unbound variable: " + x->s);
 
 } // evaluation of variable
 
 Value Fixnum::eval(Assoc &e) { return IntegerV(n); } // evaluation of a fixnum
 
-Value If::eval(Assoc &e) {
-  Value res = cond.get()->eval(e);
+Value If::eval(Assoc &e) { return run(this, e); }
+
+ExprBase *If::step(Tail &t) {
+  Value res = cond.get()->eval(t.env);
 
-  auto bool_res = dynamic_cast<Boolean *>(res.get());
-  if (bool_res && bool_res->b == false)
-    return alter.get()->eval(e);
+  if (res.w == Value::FALSE_W)
+    return alter.get();
   else
-    return conseq.get()->eval(e);
+    return conseq.get();
 } // if expression
 
 Value True::eval(Assoc &e) { return BooleanV(true); } // evaluation of #t
 
 Value False::eval(Assoc &e) { return BooleanV(false); } // evaluation of #f
 
-Value Begin::eval(Assoc &e) {
-  switch (es.size()) {
-  case 0:
-    return NullV();
-  case 1:
-    return es[0].get()->eval(e);
-  default:
-    es[0].get()->eval(e);
-    es.erase(es.begin());
-    return eval(e);
+Value Begin::eval(Assoc &e) { return run(this, e); }
+
+ExprBase *Begin::step(Tail &t) {
+  if (es.empty()) {
+    t.val = NullV();
+    return nullptr;
   }
+  for (size_t i = 0; i + 1 < es.size(); ++i)
+    es[i].get()->eval(t.env);
+  return es.back().get();
 } // begin expression
 
-Value Quote::eval(Assoc &e) {
-  auto bool_f = dynamic_cast<FalseSyntax *>(s.get());
+// the datum a quoted syntax denotes
+static Value quote(SyntaxBase *s) {
+  static Symbol *const dot = intern(".");
+  auto bool_f = dynamic_cast<FalseSyntax *>(s);
   if (bool_f)
     return BooleanV(false);
 
-  auto bool_t = dynamic_cast<TrueSyntax *>(s.get());
+  auto bool_t = dynamic_cast<TrueSyntax *>(s);
   if (bool_t)
     return BooleanV(true);
 
-  auto num = dynamic_cast<Number *>(s.get());
+  auto num = dynamic_cast<Number *>(s);
   if (num)
     return IntegerV(num->n);
 
-  auto iden = dynamic_cast<Identifier *>(s.get());
+  auto big = dynamic_cast<BigNumber *>(s);
+  if (big)
+    return parseInteger(big->digits, big->negative);
+
+  auto iden = dynamic_cast<Identifier *>(s);
   if (iden) {
-    return SymbolV(iden->s);
+    return Value(iden->s);
   }
 
-  auto list = dynamic_cast<List *>(s.get());
+  auto list = dynamic_cast<List *>(s);
   if (list) {
     if (list->stxs.size() == 0) {
       return NullV();
@@ -132,23 +294,33 @@ Value Quote::eval(Assoc &e) {
       size_t sz = list->stxs.size();
       if (sz >= 3) {
         auto isDot = dynamic_cast<Identifier *>(list->stxs[sz - 2].get());
-        if (isDot && isDot->s == ".") {
-          Value res = Expr(new Quote(list->stxs[sz - 1])).get()->eval(e);
+        if (isDot && isDot->s == dot) {
+          Value res = quote(list->stxs[sz - 1].get());
           for (int i = sz - 3; i >= 0; --i)
-            res = PairV((Expr(new Quote(list->stxs[i]))).get()->eval(e), res);
+            res = PairV(quote(list->stxs[i].get()), res);
           return res;
         }
       }
       Value res = NullV();
       for (int i = sz - 1; i >= 0; --i)
-        res = PairV((Expr(new Quote(list->stxs[i]))).get()->eval(e), res);
+        res = PairV(quote(list->stxs[i].get()), res);
       return res;
     }
   }
 
   return NullV();
+}
+
+Value Quote::eval(Assoc &e) {
+  if (!v) {
+    v.reset(new Value(quote(s.get())));
+    s = Syntax(nullptr);
+  }
+  return *v;
 } // quote expression
 
+Value Const::eval(Assoc &e) { return *v; } // folded constant
+
 Value MakeVoid::eval(Assoc &e) { return VoidV(); } // (void)
 
 Value Exit::eval(Assoc &e) { return TerminateV(); } // (exit)
@@ -161,103 +333,152 @@ Value Unary::eval(Assoc &e) {
   return evalRator(rand.get()->eval(e));
 } // evaluation of single-operator primitive
 
-Value Mult::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return IntegerV(val1->n * val2->n);
+static Value mult(const Value &rand1, const Value &rand2) {
+  int r;
+  if (rand1.type() == V_INT && rand2.type() == V_INT &&
+      !__builtin_mul_overflow(rand1.fixnum(), rand2.fixnum(), &r))
+    return IntegerV(r);
+  return numMul(rand1, rand2); // bignums, overflow and type errors
 } // *
 
-Value Plus::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return IntegerV(val1->n + val2->n);
+Value Mult::evalRator(const Value &rand1, const Value &rand2) {
+  return mult(rand1, rand2);
+}
+
+static Value plus(const Value &rand1, const Value &rand2) {
+  int r;
+  if (rand1.type() == V_INT && rand2.type() == V_INT &&
+      !__builtin_add_overflow(rand1.fixnum(), rand2.fixnum(), &r))
+    return IntegerV(r);
+  return numAdd(rand1, rand2); // bignums, overflow and type errors
 } // +
 
-Value Minus::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return IntegerV(val1->n - val2->n);
+Value Plus::evalRator(const Value &rand1, const Value &rand2) {
+  return plus(rand1, rand2);
+}
+
+static Value minus(const Value &rand1, const Value &rand2) {
+  int r;
+  if (rand1.type() == V_INT && rand2.type() == V_INT &&
+      !__builtin_sub_overflow(rand1.fixnum(), rand2.fixnum(), &r))
+    return IntegerV(r);
+  return numSub(rand1, rand2); // bignums, overflow and type errors
 } // -
 
-Value Less::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return BooleanV(val1->n < val2->n);
+Value Minus::evalRator(const Value &rand1, const Value &rand2) {
+  return minus(rand1, rand2);
+}
+
+static Value less(const Value &rand1, const Value &rand2) {
+  if (rand1.type() == V_INT && rand2.type() == V_INT)
+    return BooleanV(rand1.fixnum() < rand2.fixnum());
+  return BooleanV(numCompare(rand1, rand2) < 0);
 } // <
 
-Value LessEq::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return BooleanV(val1->n <= val2->n);
+Value Less::evalRator(const Value &rand1, const Value &rand2) {
+  return less(rand1, rand2);
+}
+
+static Value lessEq(const Value &rand1, const Value &rand2) {
+  if (rand1.type() == V_INT && rand2.type() == V_INT)
+    return BooleanV(rand1.fixnum() <= rand2.fixnum());
+  return BooleanV(numCompare(rand1, rand2) <= 0);
 } // <=
 
-Value Equal::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return BooleanV(val1->n == val2->n);
+Value LessEq::evalRator(const Value &rand1, const Value &rand2) {
+  return lessEq(rand1, rand2);
+}
+
+static Value equal(const Value &rand1, const Value &rand2) {
+  if (rand1.type() == V_INT && rand2.type() == V_INT)
+    return BooleanV(rand1.fixnum() == rand2.fixnum());
+  return BooleanV(numCompare(rand1, rand2) == 0);
 } // =
 
-Value GreaterEq::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return BooleanV(val1->n >= val2->n);
+Value Equal::evalRator(const Value &rand1, const Value &rand2) {
+  return equal(rand1, rand2);
+}
+
+static Value greaterEq(const Value &rand1, const Value &rand2) {
+  if (rand1.type() == V_INT && rand2.type() == V_INT)
+    return BooleanV(rand1.fixnum() >= rand2.fixnum());
+  return BooleanV(numCompare(rand1, rand2) >= 0);
 } // >=
 
-Value Greater::evalRator(const Value &rand1, const Value &rand2) {
-  auto val1 = dynamic_cast<Integer *>(rand1.get());
-  auto val2 = dynamic_cast<Integer *>(rand2.get());
-  if (!val1 || !val2)
-    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
-  return BooleanV(val1->n > val2->n);
+Value GreaterEq::evalRator(const Value &rand1, const Value &rand2) {
+  return greaterEq(rand1, rand2);
+}
+
+static Value greater(const Value &rand1, const Value &rand2) {
+  if (rand1.type() == V_INT && rand2.type() == V_INT)
+    return BooleanV(rand1.fixnum() > rand2.fixnum());
+  return BooleanV(numCompare(rand1, rand2) > 0);
 } // >
 
-bool isEqual(const Value &rand1, const Value &rand2) {
-  if (rand1.get() == rand2.get())
-    return true;
+Value Greater::evalRator(const Value &rand1, const Value &rand2) {
+  return greater(rand1, rand2);
+}
 
-  auto bool1 = dynamic_cast<Boolean *>(rand1.get());
-  auto bool2 = dynamic_cast<Boolean *>(rand2.get());
-  if (bool1 && bool2) {
-    return bool1->b == bool2->b;
-  }
+static Value integerOperand(Value v) {
+  if (!isInteger(v))
+    throw RuntimeError("Type error on line " + std::to_string(__LINE__));
+  return v;
+}
 
-  auto sym1 = dynamic_cast<Symbol *>(rand1.get());
-  auto sym2 = dynamic_cast<Symbol *>(rand2.get());
-  if (sym1 && sym2) {
-    return sym1->s == sym2->s;
+// op over the n values operand(0), ..., operand(n - 1), through the binary
+// primitives, so fixnums stay unboxed until a sum or product overflows; a
+// comparison asks for no operand past the first pair that fails
+template <typename Operand>
+static Value nary(ExprType op, size_t n, Operand operand) {
+  if (op >= E_LT && op <= E_GT) {
+    Value x = integerOperand(operand(0));
+    for (size_t i = 1; i < n; ++i) {
+      Value y = integerOperand(operand(i));
+      int c = numCompare(x, y);
+      bool holds = op == E_LT   ? c < 0
+                   : op == E_LE ? c <= 0
+                   : op == E_EQ ? c == 0
+                   : op == E_GE ? c >= 0
+                                : c > 0;
+      if (!holds)
+        return BooleanV(false);
+      x = std::move(y);
+    }
+    return BooleanV(true);
   }
-
-  auto num1 = dynamic_cast<Integer *>(rand1.get());
-  auto num2 = dynamic_cast<Integer *>(rand2.get());
-  if (num1 && num2) {
-    return num1->n == num2->n;
+  if (n == 0)
+    return IntegerV(op == E_MUL ? 1 : 0);
+  Value acc = integerOperand(operand(0));
+  if (n == 1 && op == E_MINUS)
+    return minus(IntegerV(0), acc);
+  for (size_t i = 1; i < n; ++i) {
+    Value x = operand(i);
+    acc = op == E_PLUS    ? plus(acc, x)
+          : op == E_MINUS ? minus(acc, x)
+                          : mult(acc, x);
   }
+  return acc;
+}
 
-  auto nul1 = dynamic_cast<Null *>(rand1.get());
-  auto nul2 = dynamic_cast<Null *>(rand2.get());
-  if (nul1 && nul2) {
-    return true;
-  }
+Value NaryArith::eval(Assoc &e) {
+  return nary(op, rands.size(), [&](size_t i) { return rands[i]->eval(e); });
+} // n-ary arithmetic
+
+// the same, as a first-class primitive
+template <ExprType op> static Value naryPrimitive(const Value *args, int n) {
+  if (n == 0 && op != E_PLUS && op != E_MUL)
+    throw RuntimeError("Expect at least 1 argument(s), found 0");
+  return nary(op, n, [&](size_t i) { return args[i]; });
+}
 
-  auto void1 = dynamic_cast<Void *>(rand1.get());
-  auto void2 = dynamic_cast<Void *>(rand2.get());
-  if (void1 && void2) {
+bool isEqual(const Value &rand1, const Value &rand2) {
+  // same object, or the same immediate (fixnum, boolean, () or #<void>);
+  // symbols are interned, so equal symbols are the same object
+  if (rand1.w == rand2.w)
     return true;
-  }
+  // bignums are numbers too, eq? whenever they are equal
+  if (rand1.type() == V_BIGNUM && rand2.type() == V_BIGNUM)
+    return numCompare(rand1, rand2) == 0;
 
   // auto str1 = dynamic_cast<String *>(rand1.get());
   // auto str2 = dynamic_cast<String *>(rand2.get());
@@ -265,91 +486,179 @@ bool isEqual(const Value &rand1, const Value &rand2) {
   //   return str1->s == str2->s;
   // }
 
-  auto var1 = dynamic_cast<Var *>(rand1.get());
-  auto var2 = dynamic_cast<Var *>(rand2.get());
-  if (var1 && var2) {
-    return var1->x == var2->x;
-  }
-
   return false;
 }
 
-Value IsEq::evalRator(const Value &rand1, const Value &rand2) {
+static Value isEq(const Value &rand1, const Value &rand2) {
   return BooleanV(isEqual(rand1, rand2));
 } // eq?
 
-Value Cons::evalRator(const Value &rand1, const Value &rand2) {
+Value IsEq::evalRator(const Value &rand1, const Value &rand2) {
+  return isEq(rand1, rand2);
+}
+
+static Value cons(const Value &rand1, const Value &rand2) {
   return PairV(rand1, rand2);
 } // cons
 
-Value IsBoolean::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Boolean *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value Cons::evalRator(const Value &rand1, const Value &rand2) {
+  return cons(rand1, rand2);
+}
+
+static Value isBoolean(const Value &rand) {
+  return BooleanV(rand.type() == V_BOOL);
 } // boolean?
 
-Value IsFixnum::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Integer *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsBoolean::evalRator(const Value &rand) {
+  return isBoolean(rand);
+}
+
+static Value isFixnum(const Value &rand) {
+  return BooleanV(isInteger(rand)); // the dialect's only integer predicate
 } // fixnum?
 
-Value IsSymbol::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Symbol *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsFixnum::evalRator(const Value &rand) {
+  return isFixnum(rand);
+}
+
+static Value isSymbol(const Value &rand) {
+  return BooleanV(rand.type() == V_SYM);
 } // symbol?
 
-Value IsNull::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Null *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsSymbol::evalRator(const Value &rand) {
+  return isSymbol(rand);
+}
+
+static Value isNull(const Value &rand) {
+  return BooleanV(rand.type() == V_NULL);
 } // null?
 
-Value IsPair::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Pair *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsNull::evalRator(const Value &rand) {
+  return isNull(rand);
+}
+
+static Value isPair(const Value &rand) {
+  return BooleanV(rand.type() == V_PAIR);
 } // pair?
 
-Value IsProcedure::evalRator(const Value &rand) {
-  auto ptr = dynamic_cast<Closure *>(rand.get());
-  if (ptr)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsPair::evalRator(const Value &rand) {
+  return isPair(rand);
+}
+
+static Value isProcedure(const Value &rand) {
+  return BooleanV(rand.type() == V_PROC || rand.type() == V_PRIMITIVE);
 } // procedure?
 
-Value Not::evalRator(const Value &rand) {
-  auto _f = dynamic_cast<Boolean *>(rand.get());
-  if (_f && _f->b == false)
-    return BooleanV(true);
-  else
-    return BooleanV(false);
+Value IsProcedure::evalRator(const Value &rand) {
+  return isProcedure(rand);
+}
+
+static Value logicalNot(const Value &rand) {
+  return BooleanV(rand.w == Value::FALSE_W);
 } // not
 
-Value Car::evalRator(const Value &rand) {
-  auto pair = dynamic_cast<Pair *>(rand.get());
-  if (pair)
-    return Value(pair->car);
+Value Not::evalRator(const Value &rand) {
+  return logicalNot(rand);
+}
+
+static Value car(const Value &rand) {
+  if (rand.type() == V_PAIR)
+    return Value(static_cast<Pair *>(rand.get())->car);
   else
     throw RuntimeError("Type error on line " + std::to_string(__LINE__));
 } // car
 
-Value Cdr::evalRator(const Value &rand) {
-  auto pair = dynamic_cast<Pair *>(rand.get());
-  if (pair)
-    return Value(pair->cdr);
+Value Car::evalRator(const Value &rand) {
+  return car(rand);
+}
+
+static Value cdr(const Value &rand) {
+  if (rand.type() == V_PAIR)
+    return Value(static_cast<Pair *>(rand.get())->cdr);
   else
     throw RuntimeError("Type error on line " + std::to_string(__LINE__));
 } // cdr
+
+Value Cdr::evalRator(const Value &rand) {
+  return cdr(rand);
+}
+
+static Value makeVoid() { return VoidV(); } // void
+
+static Value terminate() { return TerminateV(); } // exit
+
+static Primitive *newPrimitive(ExprType t) {
+  switch (t) {
+  case E_VOID:
+    return new Primitive(makeVoid);
+  case E_EXIT:
+    return new Primitive(terminate);
+  case E_MUL:
+    return new Primitive(naryPrimitive<E_MUL>);
+  case E_PLUS:
+    return new Primitive(naryPrimitive<E_PLUS>);
+  case E_MINUS:
+    return new Primitive(naryPrimitive<E_MINUS>);
+  case E_LT:
+    return new Primitive(naryPrimitive<E_LT>);
+  case E_LE:
+    return new Primitive(naryPrimitive<E_LE>);
+  case E_EQ:
+    return new Primitive(naryPrimitive<E_EQ>);
+  case E_GE:
+    return new Primitive(naryPrimitive<E_GE>);
+  case E_GT:
+    return new Primitive(naryPrimitive<E_GT>);
+  case E_EQQ:
+    return new Primitive(isEq);
+  case E_CONS:
+    return new Primitive(cons);
+  case E_BOOLQ:
+    return new Primitive(isBoolean);
+  case E_INTQ:
+    return new Primitive(isFixnum);
+  case E_NULLQ:
+    return new Primitive(isNull);
+  case E_PAIRQ:
+    return new Primitive(isPair);
+  case E_PROCQ:
+    return new Primitive(isProcedure);
+  case E_SYMBOLQ:
+    return new Primitive(isSymbol);
+  case E_NOT:
+    return new Primitive(logicalNot);
+  case E_CAR:
+    return new Primitive(car);
+  case E_CDR:
+    return new Primitive(cdr);
+  default:
+    throw RuntimeError("Not a primitive");
+  }
+}
+
+Value PrimitiveV(ExprType t) {
+  // made on first use and never freed
+  static Primitive *instances[E_CONST + 1] = {};
+  Primitive *&p = instances[t];
+  if (!p) {
+    p = newPrimitive(t);
+    p->ref_count++;
+  }
+  return Value(p);
+}
+
+Value applyPrimitive(Primitive *p, const Value *args, int argc) {
+  if (p->arity < 0)
+    return p->fn(args, argc);
+  if (argc != p->arity)
+    throw RuntimeError("Expect " + std::to_string(p->arity) +
+                       " argument(s), found " + std::to_string(argc));
+  switch (argc) {
+  case 0:
+    return p->f0();
+  case 1:
+    return p->f1(args[0]);
+  default:
+    return p->f2(args[0], args[1]);
+  }
+}
@@ -1,31 +1,39 @@
 #include "expr.hpp"
 #include "Def.hpp"
+#include "arena.hpp"
+#include "value.hpp"
 #include <cstring>
 #include <vector>
 using std::pair;
-using std::string;
 using std::vector;
 
-ExprBase::ExprBase(ExprType et) : e_type(et) {}
+static unsigned serials = 0;
+
+ExprBase::ExprBase(ExprType et) : e_type(et), serial(++serials) {}
+void *ExprBase::operator new(size_t n) { return expr_arena.allocate(n); }
+void ExprBase::operator delete(void *p) { Arena::deallocate(p); }
 
 Expr::Expr(ExprBase *eb) : ptr(eb) {}
 ExprBase *Expr::operator->() const { return ptr.get(); }
 ExprBase &Expr::operator*() { return *ptr; }
 ExprBase *Expr::get() const { return ptr.get(); }
 
-Let::Let(const vector<pair<string, Expr>> &vec, const Expr &e)
+Let::Let(const vector<pair<Symbol *, Expr>> &vec, const Expr &e)
     : ExprBase(E_LET), bind(vec), body(e) {}
 
-Lambda::Lambda(const vector<string> &vec, const Expr &expr)
+Lambda::Lambda(const vector<Symbol *> &vec, const Expr &expr)
     : ExprBase(E_LAMBDA), x(vec), e(expr) {}
 
 Apply::Apply(const Expr &expr, const vector<Expr> &vec)
-    : ExprBase(E_APPLY), rator(expr), rand(vec) {}
+    : ExprBase(E_APPLY), rator(expr), rand(vec), callee(nullptr),
+      callee_serial(0), direct(false), site(nullptr) {}
 
-Letrec::Letrec(const vector<pair<string, Expr>> &vec, const Expr &expr)
+Letrec::Letrec(const vector<pair<Symbol *, Expr>> &vec, const Expr &expr)
     : ExprBase(E_LETREC), bind(vec), body(expr) {}
 
-Var::Var(const string &s) : ExprBase(E_VAR), x(s) {}
+Var::Var(Symbol *s, bool global)
+    : ExprBase(E_VAR), x(s), global(global), boxed(false), depth(-1),
+      index(-1) {}
 
 Fixnum::Fixnum(int x) : ExprBase(E_FIXNUM), n(x) {}
 
@@ -39,6 +47,10 @@ False::False() : ExprBase(E_FALSE) {}
 Begin::Begin(const vector<Expr> &vec) : ExprBase(E_BEGIN), es(vec) {}
 
 Quote::Quote(const Syntax &t) : ExprBase(E_QUOTE), s(t) {}
+Quote::~Quote() {}
+
+Const::Const(const Value &val) : ExprBase(E_CONST), v(new Value(val)) {}
+Const::~Const() {}
 
 MakeVoid::MakeVoid() : ExprBase(E_VOID) {}
 
@@ -49,6 +61,9 @@ Binary::Binary(ExprType et, const Expr &r1, const Expr &r2)
 
 Unary::Unary(ExprType et, const Expr &expr) : ExprBase(et), rand(expr) {}
 
+NaryArith::NaryArith(ExprType et, const vector<Expr> &vec)
+    : ExprBase(E_NARY), op(et), rands(vec) {}
+
 Mult::Mult(const Expr &r1, const Expr &r2) : Binary(E_MUL, r1, r2) {}
 
 Plus::Plus(const Expr &r1, const Expr &r2) : Binary(E_PLUS, r1, r2) {}
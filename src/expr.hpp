@@ -8,15 +8,49 @@
 #include <memory>
 #include <vector>
 
-struct ExprBase {
+struct Lambda;
+struct CallSite;
+
+// compile-time mirror of one runtime frame: the parser tracks shadowing with
+// it and resolve() computes lexical addresses
+struct Scope {
+  /*
+      @attr lambda: set on the frame of a closure, whose names are the free
+     variables of lambda found so far; the frames beyond it are not reachable
+     at run time, so a name found there is captured into it
+      @attr boxed: a letrec frame, whose slots hold Boxes
+  */
+  const std::vector<Symbol *> &names;
+  const Scope *parent;
+  Lambda *lambda = nullptr;
+  bool boxed = false;
+};
+
+struct Expr;
+
+// names in scope while folding, each with the literal it is bound to, or a
+// null Expr when its value is unknown; later entries shadow earlier ones
+typedef std::vector<std::pair<Symbol *, Expr>> Constants;
+
+struct ExprBase : RefCounted {
+  /*
+      @attr serial: tells apart nodes allocated at the same address, for the
+     caches keyed on a node
+  */
   ExprType e_type;
+  unsigned serial;
   ExprBase(ExprType);
+  static void *operator new(size_t); // from expr_arena
+  static void operator delete(void *);
   virtual Value eval(Assoc &) = 0;
+  virtual ExprBase *step(Tail &);
+  virtual void resolve(const Scope *);
+  virtual Expr fold(Constants &);
   virtual ~ExprBase() = default;
 };
 
 struct Expr {
-  SharedPtr<ExprBase> ptr;
+  IntrusivePtr<ExprBase> ptr;
   Expr(ExprBase *);
   ExprBase *operator->() const;
   ExprBase &operator*();
@@ -24,38 +58,80 @@ struct Expr {
 };
 
 struct Let : ExprBase {
-  std::vector<std::pair<std::string, Expr>> bind;
+  std::vector<std::pair<Symbol *, Expr>> bind;
   Expr body;
-  Let(const std::vector<std::pair<std::string, Expr>> &, const Expr &);
+  Let(const std::vector<std::pair<Symbol *, Expr>> &, const Expr &);
   virtual Value eval(Assoc &) override;
+  virtual ExprBase *step(Tail &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Lambda : ExprBase {
-  std::vector<std::string> x;
+  /*
+      @attr free: the variables it captures, as Vars addressed in the scope
+     around it, in the order of its closures' frames (see resolve.cpp)
+      @attr free_names: their names
+  */
+  std::vector<Symbol *> x;
   Expr e;
-  Lambda(const std::vector<std::string> &, const Expr &);
+  std::vector<Expr> free;
+  std::vector<Symbol *> free_names;
+  Lambda(const std::vector<Symbol *> &, const Expr &);
   virtual Value eval(Assoc &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Apply : ExprBase {
+  /*
+      @attr callee, callee_serial: lambda of the closure called last time,
+     whose arity has been checked; a call to the same lambda skips the check.
+     Not its body: folding can give two lambdas one shared body node
+      @attr direct: that body only applies a primitive to the parameters in
+     order, so the call evaluates the primitive without building a frame
+      @attr site: its hit and miss counts, kept from the first call when
+     --stats asks for them (see stats.hpp)
+  */
   Expr rator;
   std::vector<Expr> rand;
+  Lambda *callee;
+  unsigned callee_serial;
+  bool direct;
+  CallSite *site;
   Apply(const Expr &, const std::vector<Expr> &);
   virtual Value eval(Assoc &) override;
+  virtual ExprBase *step(Tail &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 }; // this is used to handle function calling, where rator is the operator and
    // rands are operands
 
 struct Letrec : ExprBase {
-  std::vector<std::pair<std::string, Expr>> bind;
+  std::vector<std::pair<Symbol *, Expr>> bind;
   Expr body;
-  Letrec(const std::vector<std::pair<std::string, Expr>> &, const Expr &);
+  Letrec(const std::vector<std::pair<Symbol *, Expr>> &, const Expr &);
   virtual Value eval(Assoc &) override;
+  virtual ExprBase *step(Tail &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Var : ExprBase {
-  std::string x;
-  Var(const std::string &);
+  /*
+      @attr global: bound by no enclosing lambda, let or letrec, as found by
+     the parser
+      @attr boxed: bound by a letrec, so its slot holds a Box
+  */
+  Symbol *x;
+  bool global;
+  bool boxed;
+  int depth; // frames to walk up, -1 for the global table
+  int index;
+  Var(Symbol *, bool);
   virtual Value eval(Assoc &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Fixnum : ExprBase {
@@ -70,6 +146,9 @@ struct If : ExprBase {
   Expr alter;
   If(const Expr &, const Expr &, const Expr &);
   virtual Value eval(Assoc &) override;
+  virtual ExprBase *step(Tail &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct True : ExprBase {
@@ -86,12 +165,31 @@ struct Begin : ExprBase {
   std::vector<Expr> es;
   Begin(const std::vector<Expr> &);
   virtual Value eval(Assoc &) override;
+  virtual ExprBase *step(Tail &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Quote : ExprBase {
+  /*
+      @attr s: the quoted syntax, dropped once converted
+      @attr v: the datum it denotes, built on the first evaluation and shared
+     by every later one
+  */
   Syntax s;
+  std::unique_ptr<Value> v;
   Quote(const Syntax &);
   virtual Value eval(Assoc &) override;
+  virtual Expr fold(Constants &) override;
+  virtual ~Quote();
+};
+
+// a datum computed while folding, such as a quoted list
+struct Const : ExprBase {
+  std::unique_ptr<Value> v;
+  Const(const Value &);
+  virtual Value eval(Assoc &) override;
+  virtual ~Const();
 };
 
 struct MakeVoid : ExprBase {
@@ -110,6 +208,8 @@ struct Binary : ExprBase {
   Binary(ExprType, const Expr &, const Expr &);
   virtual Value evalRator(const Value &, const Value &) = 0;
   virtual Value eval(Assoc &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Unary : ExprBase {
@@ -117,6 +217,19 @@ struct Unary : ExprBase {
   Unary(ExprType, const Expr &);
   virtual Value evalRator(const Value &) = 0;
   virtual Value eval(Assoc &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
+};
+
+// +, -, * or a comparison with other than two operands; comparisons chain,
+// as in (< a b c), and stop at the first one that fails
+struct NaryArith : ExprBase {
+  ExprType op;
+  std::vector<Expr> rands;
+  NaryArith(ExprType, const std::vector<Expr> &);
+  virtual Value eval(Assoc &) override;
+  virtual void resolve(const Scope *) override;
+  virtual Expr fold(Constants &) override;
 };
 
 struct Mult : Binary {
@@ -0,0 +1,180 @@
+#include "Def.hpp"
+#include "RE.hpp"
+#include "expr.hpp"
+#include "value.hpp"
+#include <vector>
+using std::vector;
+
+// folding pass, run between parse and resolve unless -O0: evaluates
+// primitives whose operands are all literals, prunes ifs on a literal
+// condition, turns quotes into constants and substitutes let-bound literals
+// for their variables. Each fold returns the expression replacing the node.
+
+static bool isLiteral(const Expr &e) {
+  switch (e->e_type) {
+  case E_FIXNUM:
+  case E_TRUE:
+  case E_FALSE:
+  case E_VOID:
+  case E_CONST:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static Value literalValue(const Expr &e) {
+  Assoc env = empty();
+  return e->eval(env);
+}
+
+static Expr literal(const Value &v) {
+  switch (v.type()) {
+  case V_INT:
+    return Expr(new Fixnum(v.fixnum()));
+  case V_BOOL:
+    return v.boolean() ? Expr(new True()) : Expr(new False());
+  case V_VOID:
+    return Expr(new MakeVoid());
+  default:
+    return Expr(new Const(v));
+  }
+}
+
+// enters the names bound by a lambda or letrec, whose values are unknown
+static void shadow(const vector<Symbol *> &names, Constants &c) {
+  for (Symbol *x : names)
+    c.emplace_back(x, Expr(nullptr));
+}
+
+Expr ExprBase::fold(Constants &c) { return Expr(this); } // literals
+
+Expr Let::fold(Constants &c) {
+  for (auto &i : bind)
+    i.second = i.second->fold(c);
+  size_t n = c.size();
+  for (auto &i : bind)
+    c.emplace_back(i.first, isLiteral(i.second) ? i.second : Expr(nullptr));
+  body = body->fold(c);
+  c.erase(c.begin() + n, c.end());
+
+  // every use of a literal binding has been replaced by the literal
+  vector<std::pair<Symbol *, Expr>> rest;
+  for (auto &i : bind)
+    if (!isLiteral(i.second))
+      rest.push_back(i);
+  if (rest.empty())
+    return body;
+  bind = rest;
+  return Expr(this);
+} // let expression
+
+Expr Lambda::fold(Constants &c) {
+  size_t n = c.size();
+  shadow(x, c);
+  e = e->fold(c);
+  c.erase(c.begin() + n, c.end());
+  return Expr(this);
+} // lambda expression
+
+Expr Apply::fold(Constants &c) {
+  rator = rator->fold(c);
+  for (auto &i : rand)
+    i = i->fold(c);
+  return Expr(this);
+} // for function calling
+
+Expr Letrec::fold(Constants &c) {
+  size_t n = c.size();
+  for (auto &i : bind)
+    c.emplace_back(i.first, Expr(nullptr));
+  for (auto &i : bind)
+    i.second = i.second->fold(c);
+  body = body->fold(c);
+  c.erase(c.begin() + n, c.end());
+  return Expr(this);
+} // letrec expression
+
+Expr Var::fold(Constants &c) {
+  if (global)
+    return Expr(this);
+  for (size_t i = c.size(); i-- > 0;)
+    if (c[i].first == x)
+      return c[i].second.get() ? c[i].second : Expr(this);
+  return Expr(this);
+} // variable
+
+Expr If::fold(Constants &c) {
+  cond = cond->fold(c);
+  if (isLiteral(cond))
+    return (cond->e_type == E_FALSE ? alter : conseq)->fold(c);
+  conseq = conseq->fold(c);
+  alter = alter->fold(c);
+  return Expr(this);
+} // if expression
+
+Expr Begin::fold(Constants &c) {
+  vector<Expr> rest;
+  for (size_t i = 0; i < es.size(); ++i) {
+    Expr e = es[i]->fold(c);
+    // a literal has no effect, unless it is the result
+    if (i + 1 == es.size() || !isLiteral(e))
+      rest.push_back(e);
+  }
+  if (rest.size() == 1)
+    return rest[0];
+  es = rest;
+  return Expr(this);
+} // begin expression
+
+Expr Quote::fold(Constants &c) {
+  Assoc env = empty();
+  try {
+    return literal(eval(env));
+  } catch (const RuntimeError &) {
+    return Expr(this);
+  }
+} // quote expression
+
+Expr Binary::fold(Constants &c) {
+  rand1 = rand1->fold(c);
+  rand2 = rand2->fold(c);
+  // cons must allocate a fresh pair each time
+  if (e_type != E_CONS && isLiteral(rand1) && isLiteral(rand2)) {
+    try {
+      return literal(evalRator(literalValue(rand1), literalValue(rand2)));
+    } catch (const RuntimeError &) {
+      // a type error, left to be raised when evaluated
+    }
+  }
+  return Expr(this);
+} // two-operators primitive
+
+Expr Unary::fold(Constants &c) {
+  rand = rand->fold(c);
+  if (isLiteral(rand)) {
+    try {
+      return literal(evalRator(literalValue(rand)));
+    } catch (const RuntimeError &) {
+      // likewise
+    }
+  }
+  return Expr(this);
+} // single-operator primitive
+
+Expr NaryArith::fold(Constants &c) {
+  bool literals = true;
+  for (auto &i : rands) {
+    i = i->fold(c);
+    literals = literals && isLiteral(i);
+  }
+  if (literals) {
+    Assoc env = empty();
+    try {
+      return literal(eval(env));
+    } catch (const RuntimeError &) {
+      // likewise
+    }
+  }
+  return Expr(this);
+} // n-ary arithmetic
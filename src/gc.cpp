@@ -0,0 +1,84 @@
+#include "gc.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <vector>
+
+// all live objects, most recent first
+static GcObject *heap = nullptr;
+
+static const size_t MIN_THRESHOLD = 1 << 16;
+
+// collect once the heap has doubled since the last collection
+size_t gc_threshold = MIN_THRESHOLD;
+
+GcObject::GcObject() : gc_prev(nullptr), gc_next(heap), gc_count(0) {
+  if (heap)
+    heap->gc_prev = this;
+  heap = this;
+  if (++stats.heap_objects > stats.heap_peak)
+    stats.heap_peak = stats.heap_objects;
+}
+
+GcObject::~GcObject() {
+  if (gc_prev)
+    gc_prev->gc_next = gc_next;
+  else
+    heap = gc_next;
+  if (gc_next)
+    gc_next->gc_prev = gc_prev;
+  --stats.heap_objects;
+}
+
+void GcObject::trace(void (*f)(GcObject *)) {} // no references by default
+
+void GcObject::clear() {}
+
+static std::vector<GcObject *> pending;
+
+static void uncount(GcObject *o) { o->gc_count--; }
+
+static void mark(GcObject *o) {
+  if (!o->gc_mark) {
+    o->gc_mark = true;
+    pending.push_back(o);
+  }
+}
+
+void collectGarbage() {
+  stats.collections++;
+
+  // subtract the references heap objects hold on each other
+  for (GcObject *o = heap; o; o = o->gc_next) {
+    o->gc_count = o->ref_count;
+    o->gc_mark = false;
+  }
+  for (GcObject *o = heap; o; o = o->gc_next)
+    o->trace(uncount);
+
+  // whatever is left is referenced from outside: keep it and all it reaches
+  for (GcObject *o = heap; o; o = o->gc_next)
+    if (o->gc_count > 0)
+      mark(o);
+  while (!pending.empty()) {
+    GcObject *o = pending.back();
+    pending.pop_back();
+    o->trace(mark);
+  }
+
+  // break the cycles among the rest; holding each object meanwhile stops
+  // clear() from freeing one of them before it is itself cleared
+  std::vector<GcObject *> garbage;
+  for (GcObject *o = heap; o; o = o->gc_next)
+    if (!o->gc_mark) {
+      o->ref_count++;
+      garbage.push_back(o);
+    }
+  for (GcObject *o : garbage)
+    o->clear();
+  for (GcObject *o : garbage)
+    if (--o->ref_count == 0)
+      delete o;
+  stats.collected += garbage.size();
+
+  gc_threshold = std::max(MIN_THRESHOLD, 2 * stats.heap_objects);
+}
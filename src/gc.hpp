@@ -0,0 +1,45 @@
+#ifndef GC
+#define GC
+
+#include "shared.hpp"
+#include "stats.hpp"
+#include <cstddef>
+
+// Reference counting frees everything except cycles, such as a letrec Box
+// holding a closure that captures it. The collector finds those by trial
+// deletion: an object whose count is not explained by references from other
+// heap objects is held from outside the heap (the REPL's global_env, an
+// evaluation in progress, the frame stack, the VM stack), and whatever none
+// of those reaches is garbage.
+
+struct GcObject : RefCounted {
+  /*
+      @attr gc_prev, gc_next: the list of all live objects
+      @attr gc_count: ref_count minus the references from heap objects, while
+     collecting
+  */
+  GcObject *gc_prev;
+  GcObject *gc_next;
+  int gc_count;
+  bool gc_mark;
+  GcObject();
+  GcObject(const GcObject &) = delete;
+  virtual ~GcObject();
+  // calls f on every heap object this one references
+  virtual void trace(void (*f)(GcObject *));
+  // drops those references
+  virtual void clear();
+};
+
+extern size_t gc_threshold;
+
+void collectGarbage();
+
+// called at points where every live object is referenced, i.e. never
+// between allocating an object and storing it
+inline void maybeCollect() {
+  if (stats.heap_objects > gc_threshold)
+    collectGarbage();
+}
+
+#endif
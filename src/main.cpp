@@ -1,41 +1,154 @@
 #include "Def.hpp"
 #include "RE.hpp"
+#include "arena.hpp"
 #include "expr.hpp"
+#include "gc.hpp"
+#include "stats.hpp"
 #include "syntax.hpp"
 #include "value.hpp"
+#include "vm.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
-extern std::map<std::string, ExprType> primitives;
-extern std::map<std::string, ExprType> reserved_words;
+extern bool lexical_addressing;
+extern bool fold_constants;
 
-void REPL() {
-  // read - evaluation - print loop
-  Assoc global_env = empty();
-  while (1) {
-#ifndef ONLINE_JUDGE
-    std::cout << "scm> ";
+static bool use_vm = false;
+
+#ifdef ONLINE_JUDGE
+static bool quiet = true;
+#else
+static bool quiet = false;
 #endif
-    Syntax stx = readSyntax(std::cin); // read
+
+// everything the REPL prints, written out in one call whenever a prompt is
+// about to wait for input, once it has grown past OUTPUT_CHUNK, and at exit
+static std::string output;
+static const size_t OUTPUT_CHUNK = 1 << 16;
+
+static void flushOutput() {
+  for (size_t done = 0; done < output.size();) {
+    ssize_t n = write(STDOUT_FILENO, output.data() + done, output.size() - done);
+    if (n < 0 && errno != EINTR)
+      break;
+    done += n > 0 ? n : 0;
+  }
+  output.clear();
+}
+
+// read - evaluation - print loop over the reader's input, with a prompt
+// before each form if asked; false once (exit) has been evaluated
+static bool REPL(Reader &reader, Assoc &global_env, bool prompt) {
+  while (1) {
+    if (prompt) {
+      output += "scm> ";
+      flushOutput();
+    }
+    syntax_arena.reset();
+    size_t allocations = stats.allocations;
+    Syntax stx = reader.read(); // read
+    if (!stx.get())
+      return true; // end of input
+    stats.forms++;
     try {
-      Expr expr = stx->parse(global_env); // parse
+      Expr expr = stx->parse(nullptr); // parse
+      if (fold_constants) {
+        Constants none;
+        expr = expr->fold(none); // fold constants
+      }
+      expr->resolve(nullptr); // resolve variables
+      stats.parse_allocations += stats.allocations - allocations;
       // stx -> show(std :: cout); // syntax print
-      Value val = expr->eval(global_env);
-      if (val->v_type == V_TERMINATE)
-        break;
-      val->show(std::cout); // value print
+      Value val = use_vm ? runVM(expr) : expr->eval(global_env);
+      if (val.type() == V_TERMINATE)
+        return false;
+      val.show(output); // value print
     } catch (const RuntimeError &RE) {
-      // std :: cout << RE.message();
-      std::cout << "RuntimeError";
+      // output += RE.message();
+      output += "RuntimeError";
     }
-    puts("");
+    output += '\n';
+    if (output.size() >= OUTPUT_CHUNK)
+      flushOutput();
+    maybeCollect();
+  }
+}
+
+// runs a script: its forms are read straight from the mapped file, and
+// their values printed without prompts
+static bool runFile(const char *path, Assoc &global_env) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    std::cerr << path << ": " << strerror(errno) << std::endl;
+    flushOutput();
+    exit(1);
   }
+  void *text = MAP_FAILED;
+  if (S_ISREG(st.st_mode) && st.st_size > 0)
+    text = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  bool more;
+  if (text == MAP_FAILED) {
+    // not a mappable file, e.g. a pipe: read it through the descriptor
+    Reader reader(fd);
+    more = REPL(reader, global_env, false);
+  } else {
+    madvise(text, st.st_size, MADV_SEQUENTIAL);
+    Reader reader((const char *)text, st.st_size);
+    more = REPL(reader, global_env, false);
+    munmap(text, st.st_size);
+  }
+  close(fd);
+  return more;
 }
 
 int main(int argc, char *argv[]) {
-  initPrimitives();
-  initReservedWords();
-  REPL();
+  // nothing mixes C stdio with the streams, which only report errors and
+  // statistics on std::cerr
+  std::ios::sync_with_stdio(false);
+  bool show_stats = false;
+  std::vector<const char *> files;
+  for (int i = 1; i < argc; ++i)
+    if (!strcmp(argv[i], "--no-lexical"))
+      lexical_addressing = false; // look variables up by name instead
+    else if (!strcmp(argv[i], "--stats"))
+      show_stats = stats.per_site = true; // allocation counters on stderr
+    else if (!strcmp(argv[i], "-O0"))
+      fold_constants = false; // evaluate the tree exactly as parsed
+    else if (!strcmp(argv[i], "-O1"))
+      fold_constants = true;
+    else if (!strcmp(argv[i], "--vm"))
+      use_vm = true; // compile to bytecode instead of walking the tree
+    else if (!strcmp(argv[i], "--quiet"))
+      quiet = true; // no prompts
+    else if (argv[i][0] != '-')
+      files.push_back(argv[i]); // scripts, run in order instead of the REPL
+    else {
+      std::cerr << argv[0] << ": unknown option " << argv[i] << '\n'
+                << "usage: " << argv[0]
+                << " [-O0|-O1] [--vm] [--no-lexical] [--stats] [--quiet]"
+                   " [file...]"
+                << std::endl;
+      return 2;
+    }
+  Assoc global_env = empty();
+  if (files.empty()) {
+    Reader reader(std::cin);
+    REPL(reader, global_env, !quiet);
+  } else
+    for (const char *path : files)
+      if (!runFile(path, global_env))
+        break; // (exit)
+  flushOutput();
+  if (show_stats)
+    printStats(std::cerr);
   return 0;
-}
\ No newline at end of file
+}
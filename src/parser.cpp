@@ -13,97 +13,41 @@
 #include <iostream>
 #include <map>
 using std::pair;
-using std::string;
 using std::vector;
 
-extern std::map<std::string, ExprType> primitives;
-extern std::map<std::string, ExprType> reserved_words;
-
-Expr Syntax::parse(Assoc &env) {
+Expr Syntax::parse(const Scope *scope) {
   if (get() == nullptr)
     throw RuntimeError("unexpected EOF");
-  return get()->parse(env);
+  return get()->parse(scope);
 }
 
-Expr Number::parse(Assoc &env) { return Expr(new Fixnum(n)); }
-
-Expr Identifier::parse(Assoc &env) {
-  Value res = find(s, env);
-  if (res.get())
-    return Expr(new Var(s));
-
-  switch (primitives[s]) {
-  case E_VOID:
-  case E_EXIT: {
-    List *st = new List();
-    st->stxs.push_back(Syntax(new Identifier("lambda")));
-
-    st->stxs.push_back(new List());
+Expr Number::parse(const Scope *scope) { return Expr(new Fixnum(n)); }
 
-    List *stx = new List();
-    stx->stxs.push_back(Syntax(new Identifier(s)));
-    st->stxs.push_back(stx);
-
-    return st->parse(env);
-  }
+Expr BigNumber::parse(const Scope *scope) {
+  return Expr(new Const(parseInteger(digits, negative)));
+}
 
-  case E_MUL:
-  case E_MINUS:
-  case E_PLUS:
-  case E_LT:
-  case E_LE:
-  case E_EQ:
-  case E_GE:
-  case E_GT:
-  case E_EQQ:
-  case E_CONS: {
-    List *args = new List();
-    args->stxs.push_back(Syntax(new Identifier("x")));
-    args->stxs.push_back(Syntax(new Identifier("y")));
-    List *stx = new List();
-    stx->stxs.push_back(Syntax(new Identifier(s)));
-    stx->stxs.push_back(Syntax(new Identifier("x")));
-    stx->stxs.push_back(Syntax(new Identifier("y")));
-    List *st = new List();
-    st->stxs.push_back(Syntax(new Identifier("lambda")));
-    st->stxs.push_back(args);
-    st->stxs.push_back(stx);
-
-    return st->parse(env);
-  }
+// whether x is bound by an enclosing lambda, let or letrec
+static bool bound(Symbol *x, const Scope *s) {
+  for (; s != nullptr; s = s->parent)
+    if (std::find(s->names.begin(), s->names.end(), x) != s->names.end())
+      return true;
+  return false;
+}
 
-  case E_BOOLQ:
-  case E_INTQ:
-  case E_NULLQ:
-  case E_PAIRQ:
-  case E_PROCQ:
-  case E_SYMBOLQ:
-  case E_NOT:
-  case E_CAR:
-  case E_CDR: {
-    List *args = new List();
-    args->stxs.push_back(Syntax(new Identifier("x")));
-    List *stx = new List();
-    stx->stxs.push_back(Syntax(new Identifier(s)));
-    stx->stxs.push_back(Syntax(new Identifier("x")));
-    List *st = new List();
-    st->stxs.push_back(Syntax(new Identifier("lambda")));
-    st->stxs.push_back(args);
-    st->stxs.push_back(stx);
-
-    return st->parse(env);
-  }
+Expr Identifier::parse(const Scope *scope) {
+  if (bound(s, scope))
+    return Expr(new Var(s, false));
 
-  default:
-    break;
-  }
+  if (s->keyword.kind == K_PRIMITIVE)
+    return Expr(new Const(PrimitiveV(s->keyword.type)));
 
-  return Expr(new Var(s));
+  return Expr(new Var(s, true));
 }
 
-Expr TrueSyntax::parse(Assoc &env) { return Expr(new True()); }
+Expr TrueSyntax::parse(const Scope *scope) { return Expr(new True()); }
 
-Expr FalseSyntax::parse(Assoc &env) { return Expr(new False()); }
+Expr FalseSyntax::parse(const Scope *scope) { return Expr(new False()); }
 
 #define checkArgc(num, arr, line)                                              \
   if (arr.size() - 1 != num) {                                                 \
@@ -112,19 +56,29 @@ Expr FalseSyntax::parse(Assoc &env) { return Expr(new False()); }
                        std::to_string(arr.size() - 1));                        \
   }
 
-Expr List::parse(Assoc &env) {
+// +, -, * or a comparison with other than two operands
+static Expr nary(ExprType op, vector<Syntax> &stxs, const Scope *scope) {
+  if (stxs.size() == 1 && op != E_PLUS && op != E_MUL)
+    throw RuntimeError("expect at least 1 argument(s), found 0");
+  vector<Expr> rands;
+  for (size_t i = 1; i < stxs.size(); ++i)
+    rands.push_back(stxs[i].parse(scope));
+  return Expr(new NaryArith(op, rands));
+}
+
+Expr List::parse(const Scope *scope) {
   if (stxs.empty()) {
     return Expr(new MakeVoid());
   }
   auto iden = dynamic_cast<Identifier *>(stxs[0].get());
   if (iden) {
-    string s = iden->s;
+    Symbol *s = iden->s;
 
-    auto at_pri = primitives.find(s);
-    auto at_res = reserved_words.find(s);
+    bool at_pri = s->keyword.kind == K_PRIMITIVE;
+    bool at_res = s->keyword.kind == K_RESERVED;
 
-    Value res = find(s, env);
-    if (res.get()) {
+    bool local = bound(s, scope);
+    if (local) {
       goto apply;
     }
     // auto expression = dynamic_cast<Expression *>(res.get());
@@ -134,42 +88,50 @@ Expr List::parse(Assoc &env) {
     //     goto apply;
     // }
 
-    if (at_pri == primitives.end() && !stxs.size()) {
+    if (!at_pri && !stxs.size()) {
       vector<Expr> rands;
-      return Expr(new Apply(Expr(new Var(s)), rands));
-    } else if (at_pri != primitives.end()) {
-      switch (primitives[s]) {
+      return Expr(new Apply(Expr(new Var(s, true)), rands));
+    } else if (at_pri) {
+      switch (s->keyword.type) {
       case E_MUL:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Mult(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Mult(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_MINUS:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Minus(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Minus(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_PLUS:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Plus(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Plus(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_LT:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Less(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Less(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_LE:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new LessEq(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new LessEq(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_EQ:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Equal(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Equal(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_GE:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new GreaterEq(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new GreaterEq(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_GT:
-        checkArgc(2, stxs, __LINE__);
-        return Expr(new Greater(stxs[1].parse(env), stxs[2].parse(env)));
+        if (stxs.size() != 3)
+          return nary(s->keyword.type, stxs, scope);
+        return Expr(new Greater(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_VOID:
         checkArgc(0, stxs, __LINE__);
@@ -177,47 +139,47 @@ Expr List::parse(Assoc &env) {
 
       case E_EQQ:
         checkArgc(2, stxs, __LINE__);
-        return Expr(new IsEq(stxs[1].parse(env), stxs[2].parse(env)));
+        return Expr(new IsEq(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_BOOLQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsBoolean(stxs[1].parse(env)));
+        return Expr(new IsBoolean(stxs[1].parse(scope)));
 
       case E_INTQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsFixnum(stxs[1].parse(env)));
+        return Expr(new IsFixnum(stxs[1].parse(scope)));
 
       case E_NULLQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsNull(stxs[1].parse(env)));
+        return Expr(new IsNull(stxs[1].parse(scope)));
 
       case E_PAIRQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsPair(stxs[1].parse(env)));
+        return Expr(new IsPair(stxs[1].parse(scope)));
 
       case E_PROCQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsProcedure(stxs[1].parse(env)));
+        return Expr(new IsProcedure(stxs[1].parse(scope)));
 
       case E_SYMBOLQ:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new IsSymbol(stxs[1].parse(env)));
+        return Expr(new IsSymbol(stxs[1].parse(scope)));
 
       case E_CONS:
         checkArgc(2, stxs, __LINE__);
-        return Expr(new Cons(stxs[1].parse(env), stxs[2].parse(env)));
+        return Expr(new Cons(stxs[1].parse(scope), stxs[2].parse(scope)));
 
       case E_NOT:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new Not(stxs[1].parse(env)));
+        return Expr(new Not(stxs[1].parse(scope)));
 
       case E_CAR:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new Car(stxs[1].parse(env)));
+        return Expr(new Car(stxs[1].parse(scope)));
 
       case E_CDR:
         checkArgc(1, stxs, __LINE__);
-        return Expr(new Cdr(stxs[1].parse(env)));
+        return Expr(new Cdr(stxs[1].parse(scope)));
 
       case E_EXIT:
         checkArgc(0, stxs, __LINE__);
@@ -228,82 +190,78 @@ Expr List::parse(Assoc &env) {
       }
     }
 
-    if (at_res != reserved_words.end()) {
-      switch (reserved_words[s]) {
+    if (at_res) {
+      switch (s->keyword.type) {
       case E_LAMBDA: {
         checkArgc(2, stxs, __LINE__);
 
-        auto args = (dynamic_cast<List *>(stxs[1].get()))->stxs;
-        vector<string> transformedArgs;
+        auto &args = (dynamic_cast<List *>(stxs[1].get()))->stxs;
+        vector<Symbol *> transformedArgs;
 
-        Assoc env1 = env;
-
-        for (auto &syn : args) {
-          string s = dynamic_cast<Identifier *>(syn.get())->s;
-          transformedArgs.push_back(s);
-          if (!find(s, env).get())
-            env1 = extend(s, VoidV(), env1);
-        }
+        for (auto &syn : args)
+          transformedArgs.push_back(dynamic_cast<Identifier *>(syn.get())->s);
 
-        return Expr(new Lambda(transformedArgs, stxs[2].parse(env1)));
+        Scope inner{transformedArgs, scope};
+        return Expr(new Lambda(transformedArgs, stxs[2].parse(&inner)));
       }
 
       case E_LET: {
         checkArgc(2, stxs, __LINE__);
 
-        auto header = (dynamic_cast<List *>(stxs[1].get()))->stxs;
-        vector<std::pair<string, Expr>> transformedHeader;
-
-        Assoc env1 = env;
+        auto &header = (dynamic_cast<List *>(stxs[1].get()))->stxs;
+        vector<std::pair<Symbol *, Expr>> transformedHeader;
+        vector<Symbol *> names;
 
         for (auto &syn : header) {
-          auto syn_v = (dynamic_cast<List *>(syn.get()))->stxs;
+          auto &syn_v = (dynamic_cast<List *>(syn.get()))->stxs;
 
           checkArgc(1, syn_v, __LINE__);
 
-          string bind = (dynamic_cast<Identifier *>(syn_v[0].get()))->s;
-          Expr parsed = syn_v[1].parse(env);
+          Symbol *bind = (dynamic_cast<Identifier *>(syn_v[0].get()))->s;
+          Expr parsed = syn_v[1].parse(scope);
 
           transformedHeader.push_back(std::make_pair(bind, parsed));
-          env1 = extend(bind, ExpressionV(parsed), env1);
+          names.push_back(bind);
         }
 
-        return Expr(new Let(transformedHeader, stxs[2].parse(env1)));
+        Scope inner{names, scope};
+        return Expr(new Let(transformedHeader, stxs[2].parse(&inner)));
       }
 
       case E_LETREC: {
         checkArgc(2, stxs, __LINE__);
 
-        auto header = (dynamic_cast<List *>(stxs[1].get()))->stxs;
-        vector<std::pair<string, Expr>> transformedHeader;
-
-        Assoc env1 = env;
+        auto &header = (dynamic_cast<List *>(stxs[1].get()))->stxs;
+        vector<std::pair<Symbol *, Expr>> transformedHeader;
+        vector<Symbol *> names;
 
+        // the names are in scope of the bindings too
         for (auto &syn : header) {
-          auto syn_v = (dynamic_cast<List *>(syn.get()))->stxs;
-
+          auto &syn_v = (dynamic_cast<List *>(syn.get()))->stxs;
           checkArgc(1, syn_v, __LINE__);
+          names.push_back((dynamic_cast<Identifier *>(syn_v[0].get()))->s);
+        }
+        Scope inner{names, scope};
 
-          string bind = (dynamic_cast<Identifier *>(syn_v[0].get()))->s;
-          Expr parsed = syn_v[1].parse(env);
-
-          transformedHeader.push_back(std::make_pair(bind, parsed));
-          env1 = extend(bind, ExpressionV(parsed), env1);
+        for (size_t i = 0; i < header.size(); ++i) {
+          auto &syn_v = (dynamic_cast<List *>(header[i].get()))->stxs;
+          transformedHeader.push_back(
+              std::make_pair(names[i], syn_v[1].parse(&inner)));
         }
 
-        return Expr(new Letrec(transformedHeader, stxs[2].parse(env1)));
+        return Expr(new Letrec(transformedHeader, stxs[2].parse(&inner)));
       }
 
       case E_IF:
         checkArgc(3, stxs, __LINE__);
 
         return Expr(
-            new If(stxs[1].parse(env), stxs[2].parse(env), stxs[3].parse(env)));
+            new If(stxs[1].parse(scope), stxs[2].parse(scope), stxs[3].parse(scope)));
 
       case E_BEGIN: {
         vector<Expr> es;
         for (size_t i = 1; i < stxs.size(); ++i)
-          es.push_back(stxs[i].parse(env));
+          es.push_back(stxs[i].parse(scope));
         return Expr(new Begin(es));
       }
 
@@ -320,35 +278,18 @@ Expr List::parse(Assoc &env) {
   apply:
     vector<Expr> rands;
     for (size_t i = 1; i < stxs.size(); ++i)
-      rands.push_back(stxs[i].parse(env));
-    return Expr(new Apply(new Var(s), rands));
+      rands.push_back(stxs[i].parse(scope));
+    return Expr(new Apply(new Var(s, !local), rands));
   }
 
   auto list = dynamic_cast<List *>(stxs[0].get());
   if (list) {
-    // Expr parsed = list->parse(env);
-    // auto lambda = dynamic_cast<Lambda *>(parsed.get());
-    // if (lambda) {
-    //   checkArgc(lambda->x.size(), this->stxs, __LINE__);
-
-    //   Assoc env1 = env;
-
-    //   vector<Expr> rands;
-    //   for (size_t i = 1; i < stxs.size(); ++i) {
-    //     Expr e = stxs[i].parse(env);
-    //     rands.push_back(e);
-    //     env1 = extend(lambda->x[i - 1], ExpressionV(e), env1);
-    //   }
-
-    //   return Expr(new Apply(list->parse(env1), rands));
-    // } else {
     vector<Expr> rands;
     for (size_t i = 1; i < stxs.size(); ++i) {
-      Expr e = stxs[i].parse(env);
+      Expr e = stxs[i].parse(scope);
       rands.push_back(e);
     }
-    return Expr(new Apply(stxs[0].parse(env), rands));
-    // }
+    return Expr(new Apply(stxs[0].parse(scope), rands));
   }
 
   throw RuntimeError("Unknown operation");
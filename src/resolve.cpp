@@ -0,0 +1,118 @@
+#include "Def.hpp"
+#include "expr.hpp"
+#include "value.hpp"
+#include <cstring>
+#include <vector>
+using std::vector;
+
+// resolution pass: rewrites every Var into a lexical address (depth, index)
+// matching the frames built by eval; names bound nowhere go to the global
+// table
+//
+// It is also the free-variable analysis. A closure does not keep the frames
+// around its lambda; its frame holds copies of just the variables the body
+// uses from them, found here as the lookups cross the lambda's Scope. A
+// lambda body thus sees its parameters, its lets and letrecs, then that
+// frame, and nothing further but the globals. Copies are safe because only
+// letrec changes a variable after binding it, and a letrec slot holds a Box
+// that the copies share.
+
+static vector<Symbol *> bindNames(const vector<std::pair<Symbol *, Expr>> &bind) {
+  vector<Symbol *> names;
+  for (auto &i : bind)
+    names.push_back(i.first);
+  return names;
+}
+
+void ExprBase::resolve(const Scope *s) {} // literals have nothing to resolve
+
+void Let::resolve(const Scope *s) {
+  for (auto &i : bind)
+    i.second->resolve(s);
+  vector<Symbol *> names = bindNames(bind);
+  Scope s1{names, s};
+  body->resolve(&s1);
+} // let expression
+
+void Lambda::resolve(const Scope *s) {
+  free.clear();
+  free_names.clear();
+  Scope captured{free_names, s, this};
+  Scope s1{x, &captured};
+  e->resolve(&s1);
+} // lambda expression
+
+void Apply::resolve(const Scope *s) {
+  rator->resolve(s);
+  for (auto &i : rand)
+    i->resolve(s);
+} // for function calling
+
+void Letrec::resolve(const Scope *s) {
+  vector<Symbol *> names = bindNames(bind);
+  Scope s1{names, s, nullptr, true};
+  for (auto &i : bind)
+    i.second->resolve(&s1);
+  body->resolve(&s1);
+} // letrec expression
+
+// address of x seen from s, capturing it into every closure frame on the
+// way; false if x is global
+static bool lookup(Symbol *x, const Scope *s, Var &v) {
+  for (v.depth = 0; s != nullptr; s = s->parent, ++v.depth) {
+    // the later binding of a duplicated name shadows the earlier one
+    for (size_t i = s->names.size(); i-- > 0;)
+      if (s->names[i] == x) {
+        v.index = i;
+        v.boxed = s->lambda
+                      ? static_cast<Var *>(s->lambda->free[i].get())->boxed
+                      : s->boxed;
+        return true;
+      }
+    if (s->lambda) {
+      Expr e(new Var(x, false));
+      Var *from = static_cast<Var *>(e.get());
+      if (!lookup(x, s->parent, *from))
+        return false;
+      s->lambda->free.push_back(e);
+      s->lambda->free_names.push_back(x);
+      v.index = s->names.size() - 1;
+      v.boxed = from->boxed;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Var::resolve(const Scope *s) {
+  if (!global && lookup(x, s, *this))
+    return;
+  depth = -1;
+  boxed = false;
+  index = globalIndex(x);
+} // variable
+
+void If::resolve(const Scope *s) {
+  cond->resolve(s);
+  conseq->resolve(s);
+  alter->resolve(s);
+} // if expression
+
+void Begin::resolve(const Scope *s) {
+  for (auto &i : es)
+    i->resolve(s);
+} // begin expression
+
+void Binary::resolve(const Scope *s) {
+  rand1->resolve(s);
+  rand2->resolve(s);
+} // two-operators primitive
+
+void Unary::resolve(const Scope *s) {
+  rand->resolve(s);
+} // single-operator primitive
+
+void NaryArith::resolve(const Scope *s) {
+  for (auto &i : rands)
+    i->resolve(s);
+} // n-ary arithmetic
@@ -1,84 +1,86 @@
 #ifndef SHARED_PTR
 #define SHARED_PTR
 #include <iostream>
+#include <utility>
 
-template <typename T> class SharedPtr {
+// base of every object owned through an IntrusivePtr: the count lives in the
+// object itself, so managing it costs no extra allocation
+struct RefCounted {
+  int ref_count = 0;
+};
+
+template <typename T> class IntrusivePtr {
 private:
   /*
-      @attr ptr(pointer to T): a pointer to the given position
-      @attr count(pointer to int): the number of instances pointing to a same
-     place
+      @attr ptr(pointer to T): a pointer to the given position, whose
+     ref_count is the number of instances pointing to it
   */
   T *ptr;
-  int *count;
 
 public:
   // default constructor
-  SharedPtr() : ptr(nullptr), count(nullptr) {}
+  IntrusivePtr() : ptr(nullptr) {}
 
   // constructor
-  explicit SharedPtr(T *pointer) : ptr(pointer) {
-    if (pointer)
-      count = new int, *count = 1;
-    else
-      count = nullptr;
+  IntrusivePtr(T *pointer) : ptr(pointer) {
+    if (ptr)
+      ptr->ref_count++;
+  }
+
+  // copy constructor
+  IntrusivePtr(const IntrusivePtr &other) : ptr(other.ptr) {
+    if (ptr)
+      ptr->ref_count++;
   }
 
-  // copy constructors
-  SharedPtr(const SharedPtr &other) : ptr(other.ptr), count(other.count) {
-    if (this == &other)
-      return;
-    if (count)
-      (*count)++;
+  // move constructor
+  IntrusivePtr(IntrusivePtr &&other) noexcept : ptr(other.ptr) {
+    other.ptr = nullptr;
   }
 
   // operator =
-  SharedPtr &operator=(const SharedPtr &other) {
-    if (this == &other)
-      return *this;
-    this->reset();
-    ptr = other.ptr, count = other.count;
-    if (count)
-      (*count)++;
+  IntrusivePtr &operator=(const IntrusivePtr &other) {
+    if (other.ptr)
+      other.ptr->ref_count++;
+    reset();
+    ptr = other.ptr;
     return *this;
   }
 
-  int use_count() { return count ? *count : 0; }
+  IntrusivePtr &operator=(IntrusivePtr &&other) noexcept {
+    if (this != &other) {
+      reset();
+      ptr = other.ptr;
+      other.ptr = nullptr;
+    }
+    return *this;
+  }
+
+  int use_count() const { return ptr ? ptr->ref_count : 0; }
   T *get() const { return ptr; }
 
   // operator * and operator ->
-  T *operator->() { return ptr; }
-  T &operator*() { return *ptr; }
+  T *operator->() const { return ptr; }
+  T &operator*() const { return *ptr; }
 
   // operator bool
   operator bool() const { return ptr; }
 
   // reset()
   void reset() {
-    if (ptr) {
-      if (*count > 1)
-        (*count)--;
-      else {
-        delete ptr;
-        delete count;
-      }
-      ptr = nullptr, count = nullptr;
-    }
-  }
-  void reset(T *pointer) {
-    if (ptr == pointer)
-      return;
-    reset();
-    ptr = pointer;
-    if (pointer)
-      count = new int, *count = 1;
+    T *p = ptr;
+    ptr = nullptr;
+    if (p && --p->ref_count == 0)
+      delete p;
   }
+  void reset(T *pointer) { *this = IntrusivePtr(pointer); }
+
   // deconstructor
-  ~SharedPtr() { reset(); }
+  ~IntrusivePtr() { reset(); }
 };
 
 template <typename T, typename... Args>
-SharedPtr<T> make_shared(Args &&...args) {
-  return SharedPtr(new T(std::forward<Args>(args)...));
+IntrusivePtr<T> make_intrusive(Args &&...args) {
+  return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
 }
-#endif
\ No newline at end of file
+#endif
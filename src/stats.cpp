@@ -0,0 +1,51 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+Stats stats;
+
+void *operator new(size_t n) {
+  stats.allocations++;
+  if (void *p = malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void printStats(std::ostream &os) {
+  os << "forms: " << stats.forms << '\n';
+  os << "allocations: " << stats.allocations << '\n';
+  if (stats.forms)
+    os << "allocations/form: " << stats.allocations / stats.forms << '\n';
+  os << "parse allocations: " << stats.parse_allocations << '\n';
+  os << "frames: " << stats.heap_frames << " on the heap, "
+     << stats.stack_frames << " on the stack\n";
+  os << "heap objects: " << stats.heap_objects << " (peak " << stats.heap_peak
+     << ")\n";
+  os << "collections: " << stats.collections << ", freed " << stats.collected
+     << '\n';
+  std::vector<const CallSite *> sites;
+  size_t polymorphic = 0; // sites that missed more than once
+  for (const CallSite &site : stats.call_sites) {
+    sites.push_back(&site);
+    polymorphic += site.misses > 1;
+  }
+  os << "call sites: " << stats.call_hits << " hits, " << stats.call_misses
+     << " misses, " << polymorphic << " polymorphic\n";
+  // the busiest sites, most calls first
+  auto calls = [](const CallSite *c) { return c->hits + c->misses; };
+  std::stable_sort(sites.begin(), sites.end(),
+                   [&](const CallSite *a, const CallSite *b) {
+                     return calls(a) > calls(b);
+                   });
+  if (sites.size() > 20)
+    sites.resize(20);
+  for (const CallSite *site : sites)
+    os << "  " << site->callee << ": " << site->hits << " hits, "
+       << site->misses << " misses\n";
+}
@@ -0,0 +1,36 @@
+#ifndef STATS
+#define STATS
+
+#include <cstddef>
+#include <deque>
+#include <iostream>
+#include <string>
+
+// calls made from one Apply node, named after what its operator is
+struct CallSite {
+  std::string callee;
+  size_t hits, misses;
+};
+
+// counters reported by --stats
+struct Stats {
+  bool per_site;            // keep a CallSite for each Apply node called
+  size_t allocations;       // calls to operator new
+  size_t forms;             // top-level forms evaluated
+  size_t parse_allocations; // allocations made reading and parsing
+  size_t heap_objects;      // live values and frames (see gc.hpp)
+  size_t heap_frames;       // frames allocated for closures
+  size_t stack_frames;      // frames pushed on the frame stack (value.cpp)
+  size_t heap_peak;
+  size_t collections;
+  size_t collected; // objects freed by the collector
+  size_t call_hits;   // calls whose site had the callee cached (see Apply)
+  size_t call_misses;
+  std::deque<CallSite> call_sites; // filled only when per_site is set
+};
+
+extern Stats stats;
+
+void printStats(std::ostream &);
+
+#endif
@@ -1,7 +1,16 @@
 #include "syntax.hpp"
+#include "arena.hpp"
+#include "value.hpp"
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <iterator>
+#include <unistd.h>
 #include <vector>
 
+void *SyntaxBase::operator new(size_t n) { return syntax_arena.allocate(n); }
+void SyntaxBase::operator delete(void *p) { Arena::deallocate(p); }
+
 Syntax::Syntax(SyntaxBase *stx) : ptr(stx) {}
 SyntaxBase *Syntax::operator->() const { return ptr.get(); }
 SyntaxBase &Syntax::operator*() { return *ptr; }
@@ -10,12 +19,18 @@ SyntaxBase *Syntax::get() const { return ptr.get(); }
 Number::Number(int n) : n(n) {}
 void Number::show(std::ostream &os) { os << "the-number-" << n; }
 
+BigNumber::BigNumber(bool negative, const std::string &digits)
+    : negative(negative), digits(digits) {}
+void BigNumber::show(std::ostream &os) {
+  os << "the-number-" << (negative ? "-" : "") << digits;
+}
+
 void TrueSyntax::show(std::ostream &os) { os << "#t"; }
 
 void FalseSyntax::show(std::ostream &os) { os << "#f"; }
 
-Identifier::Identifier(const std::string &s1) : s(s1) {}
-void Identifier::show(std::ostream &os) { os << s; }
+Identifier::Identifier(Symbol *s1) : s(s1) {}
+void Identifier::show(std::ostream &os) { os << s->s; }
 
 List::List() {}
 void List::show(std::ostream &os) {
@@ -27,36 +42,99 @@ void List::show(std::ostream &os) {
   os << ')';
 }
 
-std::istream &readSpace(std::istream &is) {
-  while (isspace(is.peek()))
-    is.get();
-  return is;
+// character classes, indexed by byte
+enum : unsigned char { C_SPACE = 1, C_DELIMITER = 2 };
+
+struct CharClasses {
+  unsigned char c[256];
+};
+
+static constexpr CharClasses makeClasses() {
+  CharClasses t{};
+  for (char c : {' ', '\t', '\n', '\v', '\f', '\r'})
+    t.c[(unsigned char)c] = C_SPACE | C_DELIMITER;
+  for (char c : {'(', ')', '[', ']'})
+    t.c[(unsigned char)c] = C_DELIMITER;
+  return t;
 }
 
-Syntax readList(std::istream &is);
+static constexpr CharClasses classes = makeClasses();
 
-// no leading space
-Syntax readItem(std::istream &is) {
-  if (is.peek() == '(' || is.peek() == '[') {
-    is.get();
-    return readList(is);
+// bytes asked of the descriptor or stream at a time
+static const size_t CHUNK = 1 << 16;
+
+Reader::Reader(int fd)
+    : fd(fd), is(nullptr), data(nullptr), pos(0), len(0) {}
+
+Reader::Reader(std::istream &s)
+    : fd(&s == &std::cin ? STDIN_FILENO : -1),
+      is(&s == &std::cin ? nullptr : &s), data(nullptr), pos(0), len(0) {}
+
+Reader::Reader(const char *text, size_t n)
+    : fd(-1), is(nullptr), data(text), pos(0), len(n) {}
+
+// appends more input to the text, first dropping the bytes before keep,
+// which is updated along with pos; false at the end of the input
+bool Reader::fill(size_t &keep) {
+  if (fd < 0 && !is)
+    return false;
+  buf.erase(buf.begin(), buf.begin() + keep);
+  pos -= keep;
+  keep = 0;
+  size_t old = buf.size();
+  buf.resize(old + CHUNK);
+  ssize_t n;
+  if (is) {
+    is->read(buf.data() + old, CHUNK);
+    n = is->gcount();
+  } else
+    do
+      n = ::read(fd, buf.data() + old, CHUNK);
+    while (n < 0 && errno == EINTR);
+  buf.resize(old + (n > 0 ? n : 0));
+  data = buf.data();
+  len = buf.size();
+  if (n <= 0) {
+    fd = -1;
+    is = nullptr;
   }
-  if (is.peek() == '\'') {
-    is.get();
-    return readList(is);
+  return n > 0;
+}
+
+int Reader::peek() {
+  size_t keep = pos;
+  if (pos == len && !fill(keep))
+    return EOF;
+  return (unsigned char)data[pos];
+}
+
+void Reader::skipSpace() {
+  do
+    while (pos < len && (classes.c[(unsigned char)data[pos]] & C_SPACE))
+      ++pos;
+  while (pos == len && peek() != EOF);
+}
+
+// no leading space
+Syntax Reader::readItem() {
+  int c = peek();
+  if (c == '(' || c == '[' || c == '\'') {
+    ++pos;
+    return readList();
   }
-  std::string s;
-  do {
-    int c = is.peek();
-    if (c == '(' || c == ')' || c == '[' || c == ']' || isspace(c) || c == EOF)
-      break;
-    is.get();
-    s.push_back(c);
-  } while (true);
+  size_t start = pos;
+  do
+    while (pos < len && !(classes.c[(unsigned char)data[pos]] & C_DELIMITER))
+      ++pos;
+  while (pos == len && fill(start));
+  return atom(std::string_view(data + start, pos - start));
+}
+
+Syntax Reader::atom(std::string_view s) {
   // try parsing a integer
   bool neg = false;
-  int n = 0;
-  int i = 0;
+  long long n = 0;
+  size_t i = 0;
   if (s.size() == 1 && (s[0] == '+' || s[0] == '-'))
     goto identifier;
   if (s[0] == '-') {
@@ -64,13 +142,19 @@ Syntax readItem(std::istream &is) {
     neg = true;
   } else if (s[0] == '+')
     i += 1;
-  for (; i < s.size(); i++)
-    if ('0' <= s[i] && s[i] <= '9')
-      n = n * 10 + s[i] - '0';
-    else
+  for (size_t j = i; j < s.size(); j++)
+    if (s[j] < '0' || '9' < s[j])
       goto identifier;
+  for (; i < s.size(); i++) {
+    n = n * 10 + s[i] - '0';
+    if (n > (long long)INT_MAX + 1)
+      break;
+  }
   if (neg)
     n = -n;
+  if (i < s.size() || n < INT_MIN || n > INT_MAX)
+    return Syntax(new BigNumber(
+        neg, std::string(s.substr(s[0] == '-' || s[0] == '+'))));
   return Syntax(new Number(n));
 identifier:
   // not a number
@@ -78,18 +162,53 @@ identifier:
     return Syntax(new TrueSyntax());
   if (s == "#f")
     return Syntax(new FalseSyntax());
-  return Syntax(new Identifier(s));
+  return Syntax(new Identifier(intern(s)));
 }
 
-Syntax readList(std::istream &is) {
+// items of the lists being read, innermost last: a list copies its own out
+// once complete, allocating its vector exactly once
+static std::vector<Syntax> items;
+
+// after the opening bracket, or a quote, which reads the same: up to the
+// next unmatched closing bracket
+Syntax Reader::readList() {
+  size_t first = items.size();
+  int c;
+  while (skipSpace(), (c = peek()) != ')' && c != ']') {
+    if (c == EOF) {
+      // an unfinished datum is dropped with the end of the input
+      items.erase(items.begin() + first, items.end());
+      return Syntax(nullptr);
+    }
+    items.push_back(readItem());
+  }
+  ++pos; // ')'
   List *stx = new List();
-  while (readSpace(is).peek() != ')' && readSpace(is).peek() != ']')
-    stx->stxs.push_back(readItem(is));
-  is.get(); // ')'
+  stx->stxs.assign(std::make_move_iterator(items.begin() + first),
+                   std::make_move_iterator(items.end()));
+  items.erase(items.begin() + first, items.end());
   return Syntax(stx);
 }
 
-Syntax readSyntax(std::istream &is) { return readItem(readSpace(is)); }
+Syntax Reader::read() {
+  int c;
+  // a closing bracket with nothing to close is skipped
+  while (skipSpace(), (c = peek()) == ')' || c == ']')
+    ++pos;
+  if (c == EOF)
+    return Syntax(nullptr);
+  return readItem();
+}
+
+Syntax readSyntax(std::istream &is) {
+  static std::istream *source = nullptr;
+  static std::unique_ptr<Reader> reader;
+  if (&is != source) {
+    source = &is;
+    reader.reset(new Reader(is));
+  }
+  return reader->read();
+}
 
 std::istream &operator>>(std::istream &is, Syntax &stx) {
   stx = readSyntax(is);
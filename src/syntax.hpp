@@ -5,57 +5,102 @@
 #include "shared.hpp"
 #include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
-struct SyntaxBase {
-  virtual Expr parse(Assoc &) = 0;
+struct SyntaxBase : RefCounted {
+  static void *operator new(size_t); // from syntax_arena
+  static void operator delete(void *);
+  virtual Expr parse(const Scope *) = 0;
   virtual void show(std::ostream &) = 0;
   virtual ~SyntaxBase() = default;
 };
 
 struct Syntax {
-  SharedPtr<SyntaxBase> ptr;
-  // std::shared_ptr<SyntaxBase> ptr;
+  IntrusivePtr<SyntaxBase> ptr;
   Syntax(SyntaxBase *);
   SyntaxBase *operator->() const;
   SyntaxBase &operator*();
   SyntaxBase *get() const;
-  Expr parse(Assoc &);
+  Expr parse(const Scope *);
 };
 
 struct Number : SyntaxBase {
   int n;
   Number(int);
-  virtual Expr parse(Assoc &) override;
+  virtual Expr parse(const Scope *) override;
+  virtual void show(std::ostream &) override;
+};
+
+// an integer literal too large for a fixnum
+struct BigNumber : SyntaxBase {
+  bool negative;
+  std::string digits;
+  BigNumber(bool, const std::string &);
+  virtual Expr parse(const Scope *) override;
   virtual void show(std::ostream &) override;
 };
 
 struct TrueSyntax : SyntaxBase {
   // TrueSyntax();
-  virtual Expr parse(Assoc &) override;
+  virtual Expr parse(const Scope *) override;
   virtual void show(std::ostream &) override;
 };
 
 struct FalseSyntax : SyntaxBase {
   // FalseSyntax();
-  virtual Expr parse(Assoc &) override;
+  virtual Expr parse(const Scope *) override;
   virtual void show(std::ostream &) override;
 };
 
 struct Identifier : SyntaxBase {
-  std::string s;
-  Identifier(const std::string &);
-  virtual Expr parse(Assoc &) override;
+  Symbol *s; // interned, see value.hpp
+  Identifier(Symbol *);
+  virtual Expr parse(const Scope *) override;
   virtual void show(std::ostream &) override;
 };
 
 struct List : SyntaxBase {
   std::vector<Syntax> stxs;
   List();
-  virtual Expr parse(Assoc &) override;
+  virtual Expr parse(const Scope *) override;
   virtual void show(std::ostream &) override;
 };
 
+// The reader scans its text in place, in one contiguous buffer, and takes
+// tokens as views into it. A file descriptor is read in bulk whenever the
+// text runs out (a terminal still delivers a line at a time); a memory
+// range, such as an mmap'd file, is read where it lies.
+class Reader {
+public:
+  Reader(int);
+  Reader(std::istream &); // std::cin is read through its descriptor
+  Reader(const char *, size_t);
+  // the next datum, or a null Syntax once the input is exhausted
+  Syntax read();
+
+private:
+  /*
+      @attr fd, is: where more text comes from; -1 and nullptr once exhausted,
+     or for a memory range
+      @attr buf: the text read from fd or is, from the first byte still needed
+      @attr data, pos, len: the text being scanned and the position in it
+  */
+  int fd;
+  std::istream *is;
+  std::vector<char> buf;
+  const char *data;
+  size_t pos, len;
+  bool fill(size_t &);
+  int peek();
+  void skipSpace();
+  Syntax readItem();
+  Syntax readList();
+  Syntax atom(std::string_view);
+};
+
+// reads from a Reader kept for the stream, which must not be read otherwise
 Syntax readSyntax(std::istream &);
 
 std::istream &operator>>(std::istream &, Syntax);
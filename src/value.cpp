@@ -1,94 +1,295 @@
 #include "value.hpp"
+#include "RE.hpp"
+#include <charconv>
+#include <sys/mman.h>
+#include <unordered_map>
 
-AssocList::AssocList(const std::string &x, const Value &v, Assoc &next)
-    : x(x), v(v), next(next) {}
+extern bool lexical_addressing;
+
+// reserved address space for the frame stack, committed as it is touched
+static const size_t FRAME_STACK_SIZE = (size_t)1 << 30;
+static char *frame_stack = nullptr;
+static char *frame_top = nullptr;
+static std::vector<AssocList *> stacked; // its frames, the latest last
+
+// A frame is one block: the AssocList, its slots, then its names if any.
+// Closures' frames are allocated on the heap. Those of lets, letrecs and
+// calls go on the frame stack instead, as no closure ever keeps one: closures
+// copy the variables they capture (see resolve.cpp), so such a frame is only
+// referenced by the evaluation that pushed it and by the frames it pushed
+// after it. The stack holds a reference to each of its frames, so that
+// dropping the last Assoc never deletes one; popFrames() destroys them.
+
+static size_t frameBytes(size_t n, bool named) {
+  return sizeof(AssocList) + n * sizeof(Value) +
+         (named ? n * sizeof(Symbol *) : 0);
+}
+
+AssocList::AssocList(size_t n, bool named, Assoc &next)
+    : size(n), names(nullptr), slots((Value *)(this + 1)), next(next) {
+  for (size_t i = 0; i < n; ++i)
+    new (&slots[i]) Value(nullptr);
+  if (named)
+    names = (Symbol **)(slots + n);
+}
+
+AssocList::~AssocList() {
+  for (size_t i = 0; i < size; ++i)
+    slots[i].~Value();
+}
+
+void AssocList::operator delete(void *p) { ::operator delete(p); }
+
+void AssocList::trace(void (*f)(GcObject *)) {
+  for (size_t i = 0; i < size; ++i)
+    if (slots[i].get())
+      f(slots[i].get());
+  if (next.get())
+    f(next.get());
+}
+
+void AssocList::clear() {
+  for (size_t i = 0; i < size; ++i)
+    slots[i] = Value(nullptr);
+  next = Assoc(nullptr);
+}
 
 Assoc::Assoc(AssocList *x) : ptr(x) {}
 AssocList *Assoc::operator->() const { return ptr.get(); }
 AssocList &Assoc::operator*() { return *ptr; }
 AssocList *Assoc::get() const { return ptr.get(); }
 
+Tail::Tail(const Assoc &env)
+    : env(env), val(nullptr), proc(nullptr), frames(stacked.size()) {}
+
+Tail::~Tail() {
+  env = Assoc(nullptr); // before its frame goes
+  popFrames(frames);
+}
+
 Assoc empty() { return Assoc(nullptr); }
 
-Assoc extend(const std::string &x, const Value &v, Assoc &lst) {
-  return Assoc(new AssocList(x, v, lst));
+Assoc extend(size_t n, Assoc &lst) {
+  bool named = !lexical_addressing;
+  stats.heap_frames++;
+  return Assoc(new (::operator new(frameBytes(n, named)))
+                   AssocList(n, named, lst));
 }
 
-void modify(const std::string &x, const Value &v, Assoc &lst) {
-  for (auto i = lst; i.get() != nullptr; i = i->next)
-    if (x == i->x) {
-      i->v = v;
-      return;
-    }
+Assoc pushFrame(size_t n, Assoc &lst) {
+  if (!frame_stack) {
+    void *p = mmap(nullptr, FRAME_STACK_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+    frame_stack = frame_top = (char *)p;
+  }
+  bool named = !lexical_addressing;
+  size_t bytes = frameBytes(n, named);
+  if (bytes > (size_t)(frame_stack + FRAME_STACK_SIZE - frame_top))
+    throw RuntimeError("Recursion too deep");
+  AssocList *frame = new (frame_top) AssocList(n, named, lst);
+  frame_top += bytes;
+  frame->ref_count++; // the stack's own
+  stacked.push_back(frame);
+  stats.stack_frames++;
+  return Assoc(frame);
+}
+
+size_t frameHeight() { return stacked.size(); }
+
+// destroys the frames above height n, the latest first, as each may refer
+// to the ones below
+void popFrames(size_t n) {
+  while (stacked.size() > n) {
+    AssocList *frame = stacked.back();
+    stacked.pop_back();
+    frame->~AssocList();
+    frame_top = (char *)frame;
+  }
+}
+
+void bind(Assoc &frame, size_t i, Symbol *x, const Value &v) {
+  frame->slots[i] = v;
+  if (frame->names)
+    frame->names[i] = x;
 }
 
-Value find(const std::string &x, Assoc &l) {
-  for (auto i = l; i.get() != nullptr; i = i->next)
-    if (x == i->x)
-      return i->v;
+Value find(Symbol *x, Assoc &l) {
+  for (AssocList *i = l.get(); i != nullptr; i = i->next.get())
+    if (i->names)
+      for (size_t j = i->size; j-- > 0;)
+        if (x == i->names[j])
+          return i->slots[j];
   return Value(nullptr);
 }
 
-std::ostream &operator<<(std::ostream &os, Value &v) {
-  v->show(os);
+// lexical address: `depth` frames up, slot `index`; depth -1 is the global
+// table
+Value find(int depth, int index, Assoc &l) {
+  if (depth < 0)
+    return globalValue(index);
+  AssocList *i = l.get();
+  while (depth--)
+    i = i->next.get();
+  return i->slots[index];
+}
+
+static std::vector<Value> global_values;
+
+int globalIndex(Symbol *x) {
+  if (x->global < 0) {
+    x->global = global_values.size();
+    global_values.push_back(Value(nullptr));
+  }
+  return x->global;
+}
+
+Value &globalValue(int i) { return global_values[i]; }
+
+std::ostream &operator<<(std::ostream &os, const Value &v) {
+  v.show(os);
   return os;
 }
 
-void ValueBase::showCdr(std::ostream &os) {
-  os << " . ";
-  show(os);
-  os << ')';
+void Value::show(std::ostream &os) const {
+  std::string out;
+  show(out);
+  os << out;
 }
 
-void Void::show(std::ostream &os) { os << "#<void>"; }
+// fixnums, the other immediates and anything but a pair
+static void showAtom(const Value &v, std::string &out) {
+  if (v.w & 1) {
+    char buf[16];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v.fixnum()).ptr);
+  } else if (v.w == Value::FALSE_W || v.w == Value::TRUE_W)
+    out += v.boolean() ? "#t" : "#f";
+  else if (v.w == Value::NULL_W)
+    out += "()";
+  else if (v.w == Value::VOID_W)
+    out += "#<void>";
+  else
+    v.get()->show(out);
+}
 
-void Integer::show(std::ostream &os) { os << n; }
+// the list tails still to print, innermost last; an explicit stack, so a
+// long or deeply nested list costs no native stack
+static std::vector<const Value *> tails;
 
-void Boolean::show(std::ostream &os) { os << (b ? "#t" : "#f"); }
+void Value::show(std::string &out) const {
+  size_t base = tails.size();
+  const Value *v = this;
+  while (1) {
+    // v, then whatever follows it
+    for (; v->type() == V_PAIR; v = &static_cast<Pair *>(v->get())->car) {
+      out += '(';
+      tails.push_back(&static_cast<Pair *>(v->get())->cdr);
+    }
+    showAtom(*v, out);
+    for (v = nullptr; !v && tails.size() > base;) {
+      const Value *rest = tails.back();
+      if (rest->type() == V_PAIR) {
+        out += ' ';
+        tails.back() = &static_cast<Pair *>(rest->get())->cdr;
+        v = &static_cast<Pair *>(rest->get())->car;
+      } else {
+        if (rest->w != NULL_W) {
+          out += " . ";
+          showAtom(*rest, out);
+        }
+        out += ')';
+        tails.pop_back();
+      }
+    }
+    if (!v)
+      return;
+  }
+}
 
-void Symbol::show(std::ostream &os) { os << s; }
+void Symbol::show(std::string &out) { out += s; }
 
-void Null::show(std::ostream &os) { os << "()"; }
+void Terminate::show(std::string &out) { out += "()"; }
 
-void Null::showCdr(std::ostream &os) { os << ')'; }
+// pairs only a dying pair holds, freed by the outermost ~Pair: a long or
+// deeply nested list is freed in a loop, not by one nested destructor per
+// pair
+static std::vector<Value> doomed;
+static bool freeing = false;
 
-void Terminate::show(std::ostream &os) { os << "()"; }
+Pair::~Pair() {
+  if (car.type() == V_PAIR && car->ref_count == 1)
+    doomed.push_back(std::move(car));
+  if (cdr.type() == V_PAIR && cdr->ref_count == 1)
+    doomed.push_back(std::move(cdr));
+  if (freeing)
+    return;
+  freeing = true;
+  while (!doomed.empty()) {
+    Value v = std::move(doomed.back());
+    doomed.pop_back();
+  }
+  freeing = false;
+}
 
-void Pair::show(std::ostream &os) {
-  os << '(' << car;
-  cdr->showCdr(os);
+void Pair::show(std::string &out) { Value(this).show(out); }
+
+void Pair::trace(void (*f)(GcObject *)) {
+  if (car.get())
+    f(car.get());
+  if (cdr.get())
+    f(cdr.get());
 }
 
-void Pair::showCdr(std::ostream &os) {
-  os << ' ' << car;
-  cdr->showCdr(os);
+void Pair::clear() {
+  car = NullV();
+  cdr = NullV();
 }
 
-void Closure::show(std::ostream &os) { os << "#<procedure>"; }
+void Primitive::show(std::string &out) { out += "#<procedure>"; }
 
-void Expression::show(std::ostream &os) {}
+void Closure::show(std::string &out) { out += "#<procedure>"; }
 
-ValueBase::ValueBase(ValueType vt) : v_type(vt) {}
+void Closure::trace(void (*f)(GcObject *)) {
+  if (env.get())
+    f(env.get());
+}
 
-Value::Value(ValueBase *ptr) : ptr(ptr) {}
-ValueBase *Value::operator->() const { return ptr.get(); }
-ValueBase &Value::operator*() { return *ptr; }
-ValueBase *Value::get() const { return ptr.get(); }
+void Closure::clear() { env = Assoc(nullptr); }
 
-Void::Void() : ValueBase(V_VOID) {}
-Value VoidV() { return Value(new Void()); }
+Box::Box(const Value &v) : ValueBase(V_BOX), v(v) {}
 
-Integer::Integer(int n) : ValueBase(V_INT), n(n) {}
-Value IntegerV(int n) { return Value(new Integer(n)); }
+void Box::show(std::string &out) { v.show(out); }
 
-Boolean::Boolean(bool b) : ValueBase(V_BOOL), b(b) {}
-Value BooleanV(bool b) { return Value(new Boolean(b)); }
+void Box::trace(void (*f)(GcObject *)) {
+  if (v.get())
+    f(v.get());
+}
+
+void Box::clear() { v = NullV(); }
 
-Symbol::Symbol(const std::string &s) : ValueBase(V_SYM), s(s) {}
-Value SymbolV(const std::string &s) { return Value(new Symbol(s)); }
+ValueBase::ValueBase(ValueType vt) : v_type(vt) {}
+
+ValueBase *Value::operator->() const { return get(); }
+ValueBase &Value::operator*() { return *get(); }
+
+Symbol::Symbol(const std::string &s)
+    : ValueBase(V_SYM), s(s), global(-1),
+      keyword(lookupKeyword(s.data(), s.size())) {}
+
+// holding a Value keeps every symbol alive, and so the names the keys view
+static std::unordered_map<std::string_view, Value> symbols;
+
+Symbol *intern(std::string_view s) {
+  auto it = symbols.find(s);
+  if (it == symbols.end()) {
+    Symbol *sym = new Symbol(std::string(s));
+    it = symbols.emplace(sym->s, Value(sym)).first;
+  }
+  return static_cast<Symbol *>(it->second.get());
+}
 
-Null::Null() : ValueBase(V_NULL) {}
-Value NullV() { return Value(new Null()); }
+Value SymbolV(const std::string &s) { return Value(intern(s)); }
 
 Terminate::Terminate() : ValueBase(V_TERMINATE) {}
 Value TerminateV() { return Value(new Terminate()); }
@@ -99,15 +300,21 @@ Value PairV(const Value &car, const Value &cdr) {
   return Value(new Pair(car, cdr));
 }
 
-Closure::Closure(const std::vector<std::string> &xs, const Expr &e,
-                 const Assoc &env)
-    : ValueBase(V_PROC), parameters(xs), e(e), env(env) {}
-Value ClosureV(const std::vector<std::string> &xs, const Expr &e,
-               const Assoc &env) {
-  return Value(new Closure(xs, e, env));
+Closure::Closure(Lambda *lambda, const Assoc &env)
+    : ValueBase(V_PROC), lambda(lambda), env(env) {}
+Value ClosureV(Lambda *lambda, const Assoc &env) {
+  return Value(new Closure(lambda, env));
 }
 
-Expression::Expression(const Expr &e) : ValueBase(V_EXPRESSION), e(e) {}
-Value ExpressionV(const Expr &e) {
-  return Value(new Expression(e));
-}
\ No newline at end of file
+Primitive::Primitive(Value (*f)())
+    : ValueBase(V_PRIMITIVE), arity(0), f0(f), f1(nullptr), f2(nullptr),
+      fn(nullptr) {}
+Primitive::Primitive(Value (*f)(const Value &))
+    : ValueBase(V_PRIMITIVE), arity(1), f0(nullptr), f1(f), f2(nullptr),
+      fn(nullptr) {}
+Primitive::Primitive(Value (*f)(const Value &, const Value &))
+    : ValueBase(V_PRIMITIVE), arity(2), f0(nullptr), f1(nullptr), f2(f),
+      fn(nullptr) {}
+Primitive::Primitive(Value (*f)(const Value *, int))
+    : ValueBase(V_PRIMITIVE), arity(-1), f0(nullptr), f1(nullptr),
+      f2(nullptr), fn(f) {}
\ No newline at end of file
@@ -3,80 +3,203 @@
 
 #include "Def.hpp"
 #include "expr.hpp"
+#include "gc.hpp"
 #include "shared.hpp"
+#include <cstdint>
 #include <cstring>
 #include <memory>
+#include <string_view>
 #include <vector>
 
-struct ValueBase {
+struct ValueBase : GcObject {
   ValueType v_type;
   ValueBase(ValueType);
-  virtual void show(std::ostream &) = 0;
-  virtual void showCdr(std::ostream &);
+  virtual void show(std::string &) = 0; // appends the printed form
   virtual ~ValueBase() = default;
 };
 
 struct Value {
-  SharedPtr<ValueBase> ptr;
+  /*
+      @attr w: a tagged word. Fixnums have the lowest bit set, #t, #f, () and
+     #<void> are encoded with the tag 0b010, anything else is a pointer to a
+     ValueBase (0 for no value at all)
+  */
+  uintptr_t w;
   Value(ValueBase *);
-  void show(std::ostream &);
+  Value(const Value &);
+  Value(Value &&other) noexcept : w(other.w) { other.w = 0; }
+  Value &operator=(const Value &);
+  Value &operator=(Value &&) noexcept;
+  ~Value();
+  void release();
+  explicit operator bool() const { return w != 0; }
+  bool boxed() const { return w != 0 && (w & 7) == 0; }
+  ValueType type() const;
+  int fixnum() const { return (int)((intptr_t)w >> 1); }
+  bool boolean() const { return w == TRUE_W; }
+  void show(std::string &) const;
+  void show(std::ostream &) const;
   ValueBase *operator->() const;
   ValueBase &operator*();
   ValueBase *get() const;
+
+  static const uintptr_t FALSE_W = 0x02, TRUE_W = 0x0a, NULL_W = 0x12,
+                         VOID_W = 0x1a;
+  static Value immediate(uintptr_t);
 };
 
+inline Value::Value(ValueBase *ptr) : w((uintptr_t)ptr) {
+  if (ptr)
+    ptr->ref_count++;
+}
+
+inline Value::Value(const Value &other) : w(other.w) {
+  if (boxed())
+    ((ValueBase *)w)->ref_count++;
+}
+
+inline Value &Value::operator=(const Value &other) {
+  if (other.boxed())
+    ((ValueBase *)other.w)->ref_count++;
+  release();
+  w = other.w;
+  return *this;
+}
+
+inline Value &Value::operator=(Value &&other) noexcept {
+  if (this != &other) {
+    release();
+    w = other.w;
+    other.w = 0;
+  }
+  return *this;
+}
+
+inline Value::~Value() { release(); }
+
+inline void Value::release() {
+  if (boxed() && --((ValueBase *)w)->ref_count == 0)
+    delete (ValueBase *)w;
+}
+
+inline ValueType Value::type() const {
+  if (w & 1)
+    return V_INT;
+  switch (w) {
+  case FALSE_W:
+  case TRUE_W:
+    return V_BOOL;
+  case NULL_W:
+    return V_NULL;
+  case VOID_W:
+    return V_VOID;
+  }
+  return ((ValueBase *)w)->v_type;
+}
+
+// boxed values only; immediates have no ValueBase behind them
+inline ValueBase *Value::get() const {
+  return boxed() ? (ValueBase *)w : nullptr;
+}
+
+inline Value Value::immediate(uintptr_t w) {
+  Value v(nullptr);
+  v.w = w;
+  return v;
+}
+
 struct Assoc {
-  SharedPtr<AssocList> ptr;
+  IntrusivePtr<AssocList> ptr;
   Assoc(AssocList *);
   AssocList *operator->() const;
   AssocList &operator*();
   AssocList *get() const;
 };
 
-struct AssocList {
-  std::string x;
-  Value v;
+struct AssocList : GcObject {
+  /*
+      @attr names: binding names, only kept for lookups by name (the --no-lexical
+     path), else null
+      @attr slots: the values of one frame, addressed by index
+     Both arrays follow the object in the same block, on the heap or on the
+     frame stack (see value.cpp).
+  */
+  size_t size;
+  Symbol **names;
+  Value *slots;
   Assoc next;
-  AssocList(const std::string &, const Value &, Assoc &);
+  AssocList(size_t, bool, Assoc &);
+  virtual ~AssocList();
+  static void operator delete(void *);
+  virtual void trace(void (*)(GcObject *)) override;
+  virtual void clear() override;
 };
 
-struct Void : ValueBase {
-  Void();
-  virtual void show(std::ostream &) override;
+// state of an evaluation that loops through tail positions (ExprBase::step)
+struct Tail {
+  /*
+      @attr frames: height of the frame stack when the evaluation started;
+     the frames above it are the evaluation's own, popped on a tail call and
+     when it ends
+  */
+  Assoc env;
+  Value val;  // the result, once step returns nullptr
+  Value proc; // closure whose body is running, kept alive meanwhile
+  size_t frames;
+  Tail(const Assoc &);
+  ~Tail();
 };
-Value VoidV();
 
-struct Integer : ValueBase {
-  int n;
-  Integer(int);
-  virtual void show(std::ostream &) override;
-};
-Value IntegerV(int);
+// immediates, encoded in the Value itself
+inline Value VoidV() { return Value::immediate(Value::VOID_W); }
+inline Value IntegerV(int n) {
+  return Value::immediate(((uintptr_t)(intptr_t)n << 1) | 1);
+}
+inline Value BooleanV(bool b) {
+  return Value::immediate(b ? Value::TRUE_W : Value::FALSE_W);
+}
+inline Value NullV() { return Value::immediate(Value::NULL_W); }
 
-struct Boolean : ValueBase {
-  bool b;
-  Boolean(bool);
-  virtual void show(std::ostream &) override;
+// an integer outside the fixnum range; see bignum.cpp
+struct Bignum : ValueBase {
+  /*
+      @attr limbs: the magnitude in base 2^32, least significant first, with
+     no leading zero limb
+  */
+  bool negative;
+  std::vector<uint32_t> limbs;
+  Bignum(bool, std::vector<uint32_t> &&);
+  virtual void show(std::string &) override;
 };
-Value BooleanV(bool);
+// integer arithmetic on fixnums and bignums alike, throwing a type error for
+// anything else; results that fit a fixnum are always fixnums
+bool isInteger(const Value &);
+Value numAdd(const Value &, const Value &);
+Value numSub(const Value &, const Value &);
+Value numMul(const Value &, const Value &);
+int numCompare(const Value &, const Value &); // <0, 0 or >0
+Value parseInteger(const std::string &, bool); // decimal digits, sign
 
 struct Symbol : ValueBase {
+  /*
+      @attr global: slot of the symbol in the global table, -1 if none
+      @attr keyword: the primitive or reserved word it spells, looked up once
+     when interned
+  */
   std::string s;
+  int global;
+  Keyword keyword;
   Symbol(const std::string &);
-  virtual void show(std::ostream &) override;
+  virtual void show(std::string &) override;
 };
+// the one Symbol spelled s: identifiers, binding names and quoted symbols all
+// share it, so comparing names is comparing pointers. Symbols are never freed
+Symbol *intern(std::string_view);
 Value SymbolV(const std::string &);
 
-struct Null : ValueBase {
-  Null();
-  virtual void show(std::ostream &) override;
-  virtual void showCdr(std::ostream &) override;
-};
-Value NullV();
-
 struct Terminate : ValueBase {
   Terminate();
-  virtual void show(std::ostream &) override;
+  virtual void show(std::string &) override;
 };
 Value TerminateV();
 
@@ -84,38 +207,75 @@ struct Pair : ValueBase {
   Value car;
   Value cdr;
   Pair(const Value &, const Value &);
-  virtual void show(std::ostream &) override;
-  virtual void showCdr(std::ostream &) override;
+  virtual ~Pair();
+  virtual void show(std::string &) override;
+  virtual void trace(void (*)(GcObject *)) override;
+  virtual void clear() override;
 };
 Value PairV(const Value &, const Value &);
 
 struct Closure : ValueBase {
-  std::vector<std::string> parameters;
-  Expr e;
+  /*
+      @attr lambda: the Lambda node it was made from, shared by every closure
+     of that node for its parameters and body
+  */
+  IntrusivePtr<Lambda> lambda;
   Assoc env;
-  Closure(const std::vector<std::string> &, const Expr &, const Assoc &);
-  virtual void show(std::ostream &) override;
+  Closure(Lambda *, const Assoc &);
+  virtual void show(std::string &) override;
+  virtual void trace(void (*)(GcObject *)) override;
+  virtual void clear() override;
+};
+Value ClosureV(Lambda *, const Assoc &);
+
+// mutable cell holding a letrec-bound variable, shared with the closures
+// capturing it; empty until the letrec has evaluated its binding
+struct Box : ValueBase {
+  Value v;
+  Box(const Value &);
+  virtual void show(std::string &) override;
+  virtual void trace(void (*)(GcObject *)) override;
+  virtual void clear() override;
 };
-Value ClosureV(const std::vector<std::string> &, const Expr &, const Assoc &);
+
+// a primitive used as a value, e.g. car in (f car); there is one instance
+// per primitive, called through the pointer matching its arity
+struct Primitive : ValueBase {
+  /*
+      @attr arity: -1 for the variadic ones, called through fn
+  */
+  int arity;
+  Value (*f0)();
+  Value (*f1)(const Value &);
+  Value (*f2)(const Value &, const Value &);
+  Value (*fn)(const Value *, int);
+  Primitive(Value (*)());
+  Primitive(Value (*)(const Value &));
+  Primitive(Value (*)(const Value &, const Value &));
+  Primitive(Value (*)(const Value *, int));
+  virtual void show(std::string &) override;
+};
+Value PrimitiveV(ExprType);
+Value applyPrimitive(Primitive *, const Value *, int);
 
 struct String : ValueBase {
   std::string s;
   String(const std::string &);
-  virtual void show(std::ostream &) override;
+  virtual void show(std::string &) override;
 };
 Value StringV(const std::string &);
 
-struct Expression : ValueBase {
-  Expr e;
-  Expression(const Expr &);
-  virtual void show(std::ostream &) override;
-};
-Value ExpressionV(const Expr &);
-
-std::ostream &operator<<(std::ostream &, Value &);
+std::ostream &operator<<(std::ostream &, const Value &);
 
 Assoc empty();
-Assoc extend(const std::string &, const Value &, Assoc &);
-void modify(const std::string &, const Value &, Assoc &);
-Value find(const std::string &, Assoc &);
+Assoc extend(size_t, Assoc &);
+Assoc pushFrame(size_t, Assoc &);
+void popFrames(size_t);
+size_t frameHeight();
+void bind(Assoc &, size_t, Symbol *, const Value &);
+Value find(Symbol *, Assoc &);
+Value find(int, int, Assoc &);
+
+int globalIndex(Symbol *);
+Value &globalValue(int);
 #endif
\ No newline at end of file
@@ -0,0 +1,783 @@
+#include "vm.hpp"
+#include "Def.hpp"
+#include "RE.hpp"
+#include "expr.hpp"
+#include "gc.hpp"
+#include "value.hpp"
+#include <vector>
+using std::vector;
+
+bool isEqual(const Value &, const Value &);
+
+// The compiler walks the resolved Expr tree (see resolve.cpp) and turns each
+// lambda into a Proto. A call gets one window of the VM stack: the closure,
+// then its arguments and let/letrec slots, then its operand stack, so calls
+// and lets allocate nothing. Closures copy the variables they capture; as
+// only letrec ever changes a variable after binding it, only letrec
+// variables live in a shared Box.
+
+Proto::Proto(int n) : nparams(n), nlocals(n), max_stack(n) {}
+
+VMClosure::VMClosure(Proto *p) : ValueBase(V_PROC), proto(p) {}
+
+void VMClosure::show(std::string &out) { out += "#<procedure>"; }
+
+void VMClosure::trace(void (*f)(GcObject *)) {
+  for (auto &v : free)
+    if (v.get())
+      f(v.get());
+}
+
+void VMClosure::clear() { free.clear(); }
+
+[[noreturn]] static void unusable() { throw RuntimeError("Unusable variable"); }
+
+// the content of a box; a letrec box is empty until its binding is evaluated
+static inline const Value &unbox(const Value &box) {
+  const Value &v = static_cast<Box *>((ValueBase *)box.w)->v;
+  if (!v)
+    unusable();
+  return v;
+}
+
+namespace {
+
+// a function being compiled
+struct Function {
+  Proto *proto;
+  int next_slot; // first free local slot
+  int depth;     // current height of the operand stack
+};
+
+// compile-time mirror of one runtime frame of the tree-walker, so that the
+// lexical addresses of resolve.cpp still apply
+struct Frame {
+  /*
+      @attr captured: the frame of a closure, whose bindings are the captured
+     variables of the running one
+  */
+  vector<int> slots; // local slot of each binding
+  bool captured;
+  const Frame *parent;
+};
+
+struct Compiler {
+  Function *fn;
+
+  void emit(int op) { fn->proto->code.push_back(op); }
+  void emit(int op, int a) {
+    emit(op);
+    fn->proto->code.push_back(a);
+  }
+  void emit(int op, int a, int b) {
+    emit(op, a);
+    fn->proto->code.push_back(b);
+  }
+  void push() {
+    if (++fn->depth + fn->proto->nlocals > fn->proto->max_stack)
+      fn->proto->max_stack = fn->depth + fn->proto->nlocals;
+  }
+  void pop(int n = 1) { fn->depth -= n; }
+  int label() { return fn->proto->code.size(); }
+  void patch(int at) { fn->proto->code[at - 1] = label(); }
+
+  int allocSlots(int n) {
+    int first = fn->next_slot;
+    fn->next_slot += n;
+    if (fn->next_slot > fn->proto->nlocals) {
+      fn->proto->max_stack += fn->next_slot - fn->proto->nlocals;
+      fn->proto->nlocals = fn->next_slot;
+    }
+    return first;
+  }
+
+  void constant(const Value &v) {
+    fn->proto->consts.push_back(v);
+    emit(OP_CONST, fn->proto->consts.size() - 1);
+    push();
+  }
+
+  // where the local variable v is: a local slot, or ~i for captured
+  // variable i, in the encoding of Proto::captures
+  int locate(Var *v, const Frame *f) {
+    for (int d = 0; d < v->depth; ++d)
+      f = f->parent;
+    return f->captured ? ~v->index : f->slots[v->index];
+  }
+
+  void var(Var *v, const Frame *f) {
+    if (v->depth < 0) {
+      emit(OP_LOAD_GLOBAL, v->index);
+      push();
+      return;
+    }
+    int from = locate(v, f);
+    if (from >= 0)
+      emit(v->boxed ? OP_LOAD_LOCAL_BOX : OP_LOAD_LOCAL, from);
+    else
+      emit(v->boxed ? OP_LOAD_FREE_BOX : OP_LOAD_FREE, ~from);
+    push();
+  }
+
+  // compile e, leaving its value on the stack, or returning it when tail
+  void expr(ExprBase *e, const Frame *f, bool tail) {
+    switch (e->e_type) {
+    case E_LET: {
+      Let *let = static_cast<Let *>(e);
+      int saved = fn->next_slot, first = allocSlots(let->bind.size());
+      Frame f1{{}, false, f};
+      for (size_t i = 0; i < let->bind.size(); ++i) {
+        expr(let->bind[i].second.get(), f, false);
+        emit(OP_STORE_LOCAL, first + i);
+        pop();
+        f1.slots.push_back(first + i);
+      }
+      expr(let->body.get(), &f1, tail);
+      fn->next_slot = saved;
+      return;
+    }
+    case E_LETREC: {
+      Letrec *letrec = static_cast<Letrec *>(e);
+      size_t n = letrec->bind.size();
+      int saved = fn->next_slot, first = allocSlots(n);
+      Frame f1{{}, false, f};
+      for (size_t i = 0; i < n; ++i) {
+        emit(OP_MAKE_BOX, first + i);
+        f1.slots.push_back(first + i);
+      }
+      // as in Letrec::step, the boxes are only filled once every binding has
+      // been evaluated; until then loading one is an error
+      for (size_t i = 0; i < n; ++i)
+        expr(letrec->bind[i].second.get(), &f1, false);
+      for (size_t i = n; i-- > 0;) {
+        emit(OP_SET_BOX, first + i);
+        pop();
+      }
+      expr(letrec->body.get(), &f1, tail);
+      fn->next_slot = saved;
+      return;
+    }
+    case E_LAMBDA: {
+      Lambda *lambda = static_cast<Lambda *>(e);
+      IntrusivePtr<Proto> proto(new Proto(lambda->x.size()));
+      Function child{proto.get(), (int)lambda->x.size(), 0};
+      // the free variables found by resolve(), copied as in Lambda::eval
+      for (auto &i : lambda->free)
+        proto->captures.push_back(locate(static_cast<Var *>(i.get()), f));
+      Frame captured{{}, true, nullptr};
+      Frame f1{{}, false, &captured};
+      for (size_t i = 0; i < lambda->x.size(); ++i)
+        f1.slots.push_back(i);
+      Function *saved = fn;
+      fn = &child;
+      expr(lambda->e.get(), &f1, true);
+      fn = saved;
+      fn->proto->protos.push_back(proto);
+      emit(OP_CLOSURE, fn->proto->protos.size() - 1);
+      push();
+      break;
+    }
+    case E_APPLY: {
+      Apply *apply = static_cast<Apply *>(e);
+      expr(apply->rator.get(), f, false);
+      for (auto &i : apply->rand)
+        expr(i.get(), f, false);
+      emit(tail ? OP_TAILCALL : OP_CALL, apply->rand.size());
+      pop(apply->rand.size());
+      if (tail)
+        pop();
+      return;
+    }
+    case E_IF: {
+      If *i = static_cast<If *>(e);
+      expr(i->cond.get(), f, false);
+      emit(OP_JUMP_IF_FALSE, 0);
+      pop();
+      int to_alter = label();
+      expr(i->conseq.get(), f, tail);
+      int to_end = 0;
+      if (!tail) {
+        emit(OP_JUMP, 0);
+        to_end = label();
+        pop();
+      }
+      patch(to_alter);
+      expr(i->alter.get(), f, tail);
+      if (!tail)
+        patch(to_end);
+      return;
+    }
+    case E_BEGIN: {
+      Begin *begin = static_cast<Begin *>(e);
+      if (begin->es.empty()) {
+        constant(NullV());
+        break;
+      }
+      for (size_t i = 0; i + 1 < begin->es.size(); ++i) {
+        expr(begin->es[i].get(), f, false);
+        emit(OP_POP);
+        pop();
+      }
+      expr(begin->es.back().get(), f, tail);
+      return;
+    }
+    case E_VAR:
+      var(static_cast<Var *>(e), f);
+      break;
+    case E_EXIT:
+      emit(OP_EXIT);
+      push();
+      break;
+    case E_FIXNUM:
+    case E_TRUE:
+    case E_FALSE:
+    case E_VOID:
+    case E_QUOTE:
+    case E_CONST: {
+      Assoc env = empty();
+      constant(e->eval(env));
+      break;
+    }
+    case E_NARY:
+      nary(static_cast<NaryArith *>(e), f);
+      break;
+    case E_NOT:
+    case E_CAR:
+    case E_CDR:
+    case E_BOOLQ:
+    case E_INTQ:
+    case E_NULLQ:
+    case E_PAIRQ:
+    case E_PROCQ:
+    case E_SYMBOLQ:
+      expr(static_cast<Unary *>(e)->rand.get(), f, false);
+      emit(unaryOp(e->e_type));
+      break;
+    default: {
+      Binary *b = static_cast<Binary *>(e);
+      int op = binaryOp(e->e_type);
+      expr(b->rand1.get(), f, false);
+      if (op >= OP_ADD && op <= OP_GT && b->rand2->e_type == E_FIXNUM)
+        emit(op - OP_ADD + OP_ADD_IMM, static_cast<Fixnum *>(b->rand2.get())->n);
+      else {
+        expr(b->rand2.get(), f, false);
+        emit(op);
+        pop();
+      }
+      break;
+    }
+    }
+    if (tail) {
+      emit(OP_RETURN);
+      pop();
+    }
+  }
+
+  void nary(NaryArith *e, const Frame *f) {
+    int op = binaryOp(e->op);
+    auto &rands = e->rands;
+    if (op <= OP_MUL) {
+      if (rands.empty()) {
+        constant(IntegerV(op == OP_MUL ? 1 : 0));
+        return;
+      }
+      if (rands.size() == 1) {
+        if (op == OP_SUB) { // 0 - x
+          constant(IntegerV(0));
+          expr(rands[0].get(), f, false);
+          emit(OP_SUB);
+          pop();
+        } else { // x + 0 or x * 1, which checks x
+          expr(rands[0].get(), f, false);
+          emit(op - OP_ADD + OP_ADD_IMM, op == OP_MUL ? 1 : 0);
+        }
+        return;
+      }
+      expr(rands[0].get(), f, false);
+      for (size_t i = 1; i < rands.size(); ++i) {
+        expr(rands[i].get(), f, false);
+        emit(op);
+        pop();
+      }
+      return;
+    }
+    expr(rands[0].get(), f, false);
+    if (rands.size() == 1) {
+      emit(OP_ADD_IMM, 0); // checks x
+      emit(OP_POP);
+      pop();
+      constant(BooleanV(true));
+      return;
+    }
+    vector<int> exits;
+    for (size_t i = 1; i < rands.size(); ++i) {
+      expr(rands[i].get(), f, false);
+      if (i + 1 < rands.size()) {
+        emit(OP_CHAIN, op, 0);
+        exits.push_back(label());
+      } else
+        emit(op);
+      pop();
+    }
+    for (int at : exits)
+      patch(at);
+  }
+
+  static int unaryOp(ExprType t) {
+    switch (t) {
+    case E_NOT:
+      return OP_NOT;
+    case E_CAR:
+      return OP_CAR;
+    case E_CDR:
+      return OP_CDR;
+    case E_BOOLQ:
+      return OP_BOOLQ;
+    case E_INTQ:
+      return OP_INTQ;
+    case E_NULLQ:
+      return OP_NULLQ;
+    case E_PAIRQ:
+      return OP_PAIRQ;
+    case E_PROCQ:
+      return OP_PROCQ;
+    default:
+      return OP_SYMBOLQ;
+    }
+  }
+
+  static int binaryOp(ExprType t) {
+    switch (t) {
+    case E_PLUS:
+      return OP_ADD;
+    case E_MINUS:
+      return OP_SUB;
+    case E_MUL:
+      return OP_MUL;
+    case E_LT:
+      return OP_LT;
+    case E_LE:
+      return OP_LE;
+    case E_EQ:
+      return OP_EQ;
+    case E_GE:
+      return OP_GE;
+    case E_GT:
+      return OP_GT;
+    case E_EQQ:
+      return OP_EQQ;
+    default:
+      return OP_CONS;
+    }
+  }
+};
+
+// state of a call in progress
+struct CallFrame {
+  Proto *proto;
+  const int *pc;
+  size_t bp; // first argument; the closure sits just below
+};
+
+vector<Value> stack(1 << 12, Value(nullptr));
+vector<CallFrame> frames;
+
+void grow(size_t n) {
+  stack.resize(std::max(n, 2 * stack.size()), Value(nullptr));
+}
+
+inline void reserve(size_t n) {
+  if (n > stack.size())
+    grow(n);
+}
+
+[[noreturn]] void badCall(const Value &v, int argc) {
+  if (v.type() != V_PROC)
+    throw RuntimeError("Bad function call");
+  int n = static_cast<VMClosure *>(v.get())->proto->nparams;
+  throw RuntimeError("Expect " + std::to_string(n) + " argument(s), found " +
+                     std::to_string(argc));
+}
+
+// the closure to call with argc arguments, or nullptr for a primitive;
+// tests the pointer tag straight away, as closures are the common case
+inline VMClosure *callee(const Value &v, int argc) {
+  if (v.boxed()) {
+    ValueBase *f = (ValueBase *)v.w;
+    if (f->v_type == V_PROC &&
+        static_cast<VMClosure *>(f)->proto->nparams == argc)
+      return static_cast<VMClosure *>(f);
+    if (f->v_type == V_PRIMITIVE)
+      return nullptr;
+  }
+  badCall(v, argc);
+}
+
+// replaces a primitive and its argc arguments on top of the stack by the
+// result of the call
+inline void callPrimitive(Value *stack, size_t &sp, int argc) {
+  Value res = applyPrimitive(static_cast<Primitive *>(stack[sp - argc - 1].get()),
+                             stack + sp - argc, argc);
+  while (argc-- >= 0)
+    stack[--sp] = Value(nullptr);
+  stack[sp++] = std::move(res);
+}
+
+[[noreturn]] void typeError() { throw RuntimeError("Type error"); }
+
+Value execute(Proto *top) {
+  size_t bp = 1, sp = 1 + top->nlocals;
+  reserve(1 + top->max_stack);
+  Value *stack = ::stack.data(); // refreshed after every reserve()
+  Proto *proto = top;
+  const int *pc = top->code.data();
+  VMClosure *closure = nullptr;
+  Value imm_y(nullptr); // y of the _IMM instructions, always a fixnum
+
+#define TOP stack[sp - 1]
+// operands of an integer primitive: x, the left one, is left on the stack
+// for the result; y is popped, or is the fixnum in the instruction for the
+// _IMM forms. Two fixnums are computed inline on the bare words, with no
+// Value temporaries to release; a bignum, an overflow or a type error goes
+// through the generic functions of bignum.cpp
+#define INT_OPERANDS(imm)                                                      \
+  Value &x = stack[sp - (imm ? 1 : 2)];                                        \
+  Value &y = imm ? (imm_y.w = IntegerV(*pc++).w, imm_y) : stack[--sp];         \
+  bool fixnums = x.w & y.w & 1;
+#define ARITH(checked, generic, imm)                                           \
+  {                                                                            \
+    INT_OPERANDS(imm)                                                          \
+    int r;                                                                     \
+    if (fixnums && !checked(x.fixnum(), y.fixnum(), &r)) {                     \
+      x.w = IntegerV(r).w;                                                     \
+      y.w = 0;                                                                 \
+    } else {                                                                   \
+      x = generic(x, y);                                                       \
+      y = Value(nullptr);                                                      \
+    }                                                                          \
+    NEXT;                                                                      \
+  }
+// a comparison feeding an if branches directly instead of pushing a boolean
+#define COMPARE(op, imm)                                                       \
+  {                                                                            \
+    INT_OPERANDS(imm)                                                          \
+    bool r;                                                                    \
+    if (fixnums) {                                                             \
+      r = x.fixnum() op y.fixnum();                                            \
+      x.w = y.w = 0;                                                           \
+    } else {                                                                   \
+      r = numCompare(x, y) op 0;                                               \
+      x = y = Value(nullptr);                                                  \
+    }                                                                          \
+    if (*pc == OP_JUMP_IF_FALSE) {                                             \
+      --sp;                                                                    \
+      pc = r ? pc + 2 : proto->code.data() + pc[1];                            \
+    } else                                                                     \
+      x.w = BooleanV(r).w;                                                     \
+    NEXT;                                                                      \
+  }
+
+#ifdef __GNUC__
+  // threaded dispatch: one indirect jump per instruction, so each opcode's
+  // successor gets its own branch prediction; the switch only starts it off
+  static void *const targets[] = {
+      &&L_OP_CONST,
+      &&L_OP_LOAD_LOCAL,
+      &&L_OP_STORE_LOCAL,
+      &&L_OP_LOAD_FREE,
+      &&L_OP_LOAD_LOCAL_BOX,
+      &&L_OP_LOAD_FREE_BOX,
+      &&L_OP_LOAD_GLOBAL,
+      &&L_OP_MAKE_BOX,
+      &&L_OP_SET_BOX,
+      &&L_OP_POP,
+      &&L_OP_JUMP,
+      &&L_OP_JUMP_IF_FALSE,
+      &&L_OP_CLOSURE,
+      &&L_OP_CALL,
+      &&L_OP_TAILCALL,
+      &&L_OP_RETURN,
+      &&L_OP_EXIT,
+      &&L_OP_ADD,
+      &&L_OP_SUB,
+      &&L_OP_MUL,
+      &&L_OP_LT,
+      &&L_OP_LE,
+      &&L_OP_EQ,
+      &&L_OP_GE,
+      &&L_OP_GT,
+      &&L_OP_ADD_IMM,
+      &&L_OP_SUB_IMM,
+      &&L_OP_MUL_IMM,
+      &&L_OP_LT_IMM,
+      &&L_OP_LE_IMM,
+      &&L_OP_EQ_IMM,
+      &&L_OP_GE_IMM,
+      &&L_OP_GT_IMM,
+      &&L_OP_CHAIN,
+      &&L_OP_EQQ,
+      &&L_OP_CONS,
+      &&L_OP_CAR,
+      &&L_OP_CDR,
+      &&L_OP_NOT,
+      &&L_OP_BOOLQ,
+      &&L_OP_INTQ,
+      &&L_OP_NULLQ,
+      &&L_OP_PAIRQ,
+      &&L_OP_PROCQ,
+      &&L_OP_SYMBOLQ,
+  };
+#define CASE(op)                                                               \
+  case op:                                                                     \
+    L_##op
+#define NEXT goto *targets[*pc++]
+#else
+#define CASE(op) case op
+#define NEXT break
+#endif
+
+  for (;;) {
+    switch (*pc++) {
+    CASE(OP_CONST):
+      stack[sp++] = proto->consts[*pc++];
+      NEXT;
+    CASE(OP_LOAD_LOCAL):
+      stack[sp++] = stack[bp + *pc++];
+      NEXT;
+    CASE(OP_STORE_LOCAL):
+      stack[bp + *pc++] = std::move(stack[--sp]);
+      NEXT;
+    CASE(OP_LOAD_FREE):
+      stack[sp++] = closure->free[*pc++];
+      NEXT;
+    CASE(OP_LOAD_GLOBAL): {
+      Value &v = globalValue(*pc++);
+      if (!v)
+        throw RuntimeError("Unbound variable");
+      stack[sp++] = v;
+      NEXT;
+    }
+    CASE(OP_MAKE_BOX):
+      stack[bp + *pc++] = Value(new Box(Value(nullptr)));
+      NEXT;
+    CASE(OP_SET_BOX):
+      static_cast<Box *>(stack[bp + *pc++].get())->v = std::move(stack[--sp]);
+      NEXT;
+    CASE(OP_LOAD_LOCAL_BOX):
+      stack[sp++] = unbox(stack[bp + *pc++]);
+      NEXT;
+    CASE(OP_LOAD_FREE_BOX):
+      stack[sp++] = unbox(closure->free[*pc++]);
+      NEXT;
+    CASE(OP_POP):
+      stack[--sp].release();
+      stack[sp].w = 0;
+      NEXT;
+    CASE(OP_JUMP):
+      pc = proto->code.data() + *pc;
+      NEXT;
+    CASE(OP_JUMP_IF_FALSE):
+      if (stack[--sp].w == Value::FALSE_W)
+        pc = proto->code.data() + *pc;
+      else
+        ++pc;
+      stack[sp].release();
+      stack[sp].w = 0;
+      NEXT;
+    CASE(OP_CLOSURE): {
+      Proto *p = proto->protos[*pc++].get();
+      VMClosure *c = new VMClosure(p);
+      c->free.reserve(p->captures.size());
+      for (int from : p->captures)
+        c->free.push_back(from >= 0 ? stack[bp + from] : closure->free[~from]);
+      stack[sp++] = Value(c);
+      NEXT;
+    }
+    CASE(OP_CALL): {
+      int argc = *pc++;
+      VMClosure *c = callee(stack[sp - argc - 1], argc);
+      if (!c) {
+        callPrimitive(stack, sp, argc);
+        NEXT;
+      }
+      maybeCollect();
+      frames.push_back({proto, pc, bp});
+      bp = sp - argc;
+      proto = c->proto.get();
+      reserve(bp + proto->max_stack);
+      stack = ::stack.data();
+      sp = bp + proto->nlocals;
+      pc = proto->code.data();
+      closure = c;
+      NEXT;
+    }
+    CASE(OP_TAILCALL): {
+      int argc = *pc++;
+      VMClosure *c = callee(stack[sp - argc - 1], argc);
+      if (!c) {
+        callPrimitive(stack, sp, argc);
+        goto do_return;
+      }
+      maybeCollect();
+      // slide the callee and its arguments over the running frame
+      size_t from = sp - argc - 1;
+      for (int i = 0; i <= argc; ++i)
+        stack[bp - 1 + i] = std::move(stack[from + i]);
+      for (size_t i = bp + argc; i < sp; ++i)
+        stack[i] = Value(nullptr);
+      c = static_cast<VMClosure *>(stack[bp - 1].get());
+      proto = c->proto.get();
+      reserve(bp + proto->max_stack);
+      stack = ::stack.data();
+      sp = bp + proto->nlocals;
+      pc = proto->code.data();
+      closure = c;
+      NEXT;
+    }
+    CASE(OP_RETURN):
+    do_return: {
+      Value res = std::move(stack[--sp]);
+      for (size_t i = bp - 1; i < sp; ++i)
+        stack[i] = Value(nullptr);
+      sp = bp;
+      stack[bp - 1] = std::move(res);
+      if (frames.empty()) {
+        res = std::move(stack[0]);
+        return res;
+      }
+      proto = frames.back().proto;
+      pc = frames.back().pc;
+      bp = frames.back().bp;
+      frames.pop_back();
+      closure = static_cast<VMClosure *>(stack[bp - 1].get());
+      NEXT;
+    }
+    CASE(OP_EXIT):
+      stack[sp++] = TerminateV();
+      NEXT;
+    CASE(OP_ADD):
+      ARITH(__builtin_add_overflow, numAdd, 0)
+    CASE(OP_SUB):
+      ARITH(__builtin_sub_overflow, numSub, 0)
+    CASE(OP_MUL):
+      ARITH(__builtin_mul_overflow, numMul, 0)
+    CASE(OP_LT):
+      COMPARE(<, 0)
+    CASE(OP_LE):
+      COMPARE(<=, 0)
+    CASE(OP_EQ):
+      COMPARE(==, 0)
+    CASE(OP_GE):
+      COMPARE(>=, 0)
+    CASE(OP_GT):
+      COMPARE(>, 0)
+    CASE(OP_ADD_IMM):
+      ARITH(__builtin_add_overflow, numAdd, 1)
+    CASE(OP_SUB_IMM):
+      ARITH(__builtin_sub_overflow, numSub, 1)
+    CASE(OP_MUL_IMM):
+      ARITH(__builtin_mul_overflow, numMul, 1)
+    CASE(OP_LT_IMM):
+      COMPARE(<, 1)
+    CASE(OP_LE_IMM):
+      COMPARE(<=, 1)
+    CASE(OP_EQ_IMM):
+      COMPARE(==, 1)
+    CASE(OP_GE_IMM):
+      COMPARE(>=, 1)
+    CASE(OP_GT_IMM):
+      COMPARE(>, 1)
+    CASE(OP_CHAIN): {
+      Value &x = stack[sp - 2], &y = stack[sp - 1];
+      int a = x.fixnum(), b = y.fixnum();
+      int c = x.w & y.w & 1 ? (a > b) - (a < b) : numCompare(x, y);
+      bool r = *pc == OP_LT   ? c < 0
+               : *pc == OP_LE ? c <= 0
+               : *pc == OP_EQ ? c == 0
+               : *pc == OP_GE ? c >= 0
+                              : c > 0;
+      --sp;
+      if (r) {
+        x = std::move(y);
+        pc += 2;
+      } else {
+        x = BooleanV(false);
+        y = Value(nullptr);
+        pc = proto->code.data() + pc[1];
+      }
+      NEXT;
+    }
+    CASE(OP_EQQ): {
+      Value v = BooleanV(isEqual(stack[sp - 2], stack[sp - 1]));
+      stack[--sp] = Value(nullptr);
+      TOP = v;
+      NEXT;
+    }
+    CASE(OP_CONS): {
+      Value v = PairV(stack[sp - 2], stack[sp - 1]);
+      stack[--sp] = Value(nullptr);
+      TOP = std::move(v);
+      NEXT;
+    }
+    CASE(OP_CAR):
+    CASE(OP_CDR): {
+      if (TOP.type() != V_PAIR)
+        typeError();
+      Pair *p = static_cast<Pair *>(TOP.get());
+      Value v = pc[-1] == OP_CAR ? p->car : p->cdr;
+      TOP = std::move(v);
+      NEXT;
+    }
+    CASE(OP_NOT):
+      TOP = BooleanV(TOP.w == Value::FALSE_W);
+      NEXT;
+    CASE(OP_BOOLQ):
+      TOP = BooleanV(TOP.type() == V_BOOL);
+      NEXT;
+    CASE(OP_INTQ):
+      TOP = BooleanV(isInteger(TOP));
+      NEXT;
+    CASE(OP_NULLQ):
+      TOP = BooleanV(TOP.type() == V_NULL);
+      NEXT;
+    CASE(OP_PAIRQ):
+      TOP = BooleanV(TOP.type() == V_PAIR);
+      NEXT;
+    CASE(OP_PROCQ):
+      TOP = BooleanV(TOP.type() == V_PROC || TOP.type() == V_PRIMITIVE);
+      NEXT;
+    CASE(OP_SYMBOLQ):
+      TOP = BooleanV(TOP.type() == V_SYM);
+      NEXT;
+    }
+  }
+#undef NEXT
+#undef CASE
+#undef COMPARE
+#undef ARITH
+#undef INT_OPERANDS
+#undef TOP
+}
+
+} // namespace
+
+IntrusivePtr<Proto> compile(const Expr &e) {
+  IntrusivePtr<Proto> top(new Proto(0));
+  Function fn{top.get(), 0, 0};
+  Compiler c{&fn};
+  c.expr(e.get(), nullptr, true);
+  return top;
+}
+
+Value runVM(const Expr &e) {
+  IntrusivePtr<Proto> top = compile(e);
+  try {
+    return execute(top.get());
+  } catch (const RuntimeError &) {
+    // drop whatever the unfinished calls left on the stack
+    for (auto &v : stack)
+      v = Value(nullptr);
+    frames.clear();
+    throw;
+  }
+}
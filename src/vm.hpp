@@ -0,0 +1,89 @@
+#ifndef VM
+#define VM
+
+// bytecode compiler and stack machine, selected with --vm
+
+#include "Def.hpp"
+#include "expr.hpp"
+#include "shared.hpp"
+#include "value.hpp"
+#include <vector>
+
+enum OpCode {
+  OP_CONST,          // push consts[a]
+  OP_LOAD_LOCAL,     // push local a
+  OP_STORE_LOCAL,    // pop into local a
+  OP_LOAD_FREE,      // push captured variable a of the running closure
+  OP_LOAD_LOCAL_BOX, // push the content of the box in local a
+  OP_LOAD_FREE_BOX,  // push the content of the box in captured variable a
+  OP_LOAD_GLOBAL,    // push global a, which must be bound
+  OP_MAKE_BOX,       // local a = a new box, empty until set
+  OP_SET_BOX,        // pop into the box in local a
+  OP_POP,            // drop the top
+  OP_JUMP,           // go to a
+  OP_JUMP_IF_FALSE,  // pop, go to a if it is #f
+  OP_CLOSURE,        // push a closure over protos[a]
+  OP_CALL,           // call with a arguments
+  OP_TAILCALL,       // call with a arguments, replacing the running frame
+  OP_RETURN,         // return the top
+  OP_EXIT,           // push the value of (exit)
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_LT,
+  OP_LE,
+  OP_EQ,
+  OP_GE,
+  OP_GT,
+  OP_ADD_IMM,        // the same, with the fixnum a as right operand
+  OP_SUB_IMM,
+  OP_MUL_IMM,
+  OP_LT_IMM,
+  OP_LE_IMM,
+  OP_EQ_IMM,
+  OP_GE_IMM,
+  OP_GT_IMM,
+  OP_CHAIN,          // a comparison (a) inside a chain such as (< x y z):
+                     // pop y; if it holds, y replaces x, else #f does and
+                     // control goes to b
+  OP_EQQ,
+  OP_CONS,
+  OP_CAR,
+  OP_CDR,
+  OP_NOT,
+  OP_BOOLQ,
+  OP_INTQ,
+  OP_NULLQ,
+  OP_PAIRQ,
+  OP_PROCQ,
+  OP_SYMBOLQ
+};
+
+// compiled body of one lambda, or of a top-level form
+struct Proto : RefCounted {
+  int nparams;
+  int nlocals;    // parameters, then let/letrec slots
+  int max_stack;  // nlocals plus the deepest operand stack
+  std::vector<int> code; // opcodes, each followed by its operand if any
+  std::vector<Value> consts;
+  std::vector<IntrusivePtr<Proto>> protos;
+  // where each captured variable comes from in the enclosing function: a
+  // local slot, or ~i for its own captured variable i
+  std::vector<int> captures;
+  Proto(int);
+};
+
+// a procedure made by OP_CLOSURE: the code plus a copy of its free variables
+struct VMClosure : ValueBase {
+  IntrusivePtr<Proto> proto;
+  std::vector<Value> free;
+  VMClosure(Proto *);
+  virtual void show(std::string &) override;
+  virtual void trace(void (*)(GcObject *)) override;
+  virtual void clear() override;
+};
+
+IntrusivePtr<Proto> compile(const Expr &);
+Value runVM(const Expr &);
+
+#endif